@@ -15,6 +15,7 @@
  */
 
 #include "src/common.h"
+#include "src/arrow.h"
 #include "src/convert.h"
 #include "src/encoder.h"
 #include "src/row.h"
@@ -60,14 +61,13 @@ static PyObject* Cmd_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
 
 static int Cmd_init(Cmd *self, PyObject *args, PyObject *kwargs) {
     char *host=NULL, *username=NULL, *password=NULL, *logon_mech=NULL, *logon_mech_data=NULL;
+    char *charset=NULL;
     uint32_t settings = 0;
 
-    static char *kwlist[] = {"host", "username", "password", "logon_mech", "logon_mech_data", "encoder_settings", NULL};
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ssszz|i", kwlist, &host, &username, &password,
-            &logon_mech, &logon_mech_data, &settings)) {
-        return -1;
-    }
-    if ((self->conn = teradata_connect(host, username, password, logon_mech, logon_mech_data)) == NULL) {
+    static char *kwlist[] = {"host", "username", "password", "logon_mech", "logon_mech_data", "encoder_settings",
+        "charset", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ssszz|iz", kwlist, &host, &username, &password,
+            &logon_mech, &logon_mech_data, &settings, &charset)) {
         return -1;
     }
     self->encoder = encoder_new(NULL, settings);
@@ -75,6 +75,17 @@ static int Cmd_init(Cmd *self, PyObject *args, PyObject *kwargs) {
         PyErr_Format(PyExc_ValueError, "Could not create encoder, settings value 0x%06x is invalid.", settings);
         return -1;
     }
+    self->encoder->Owner = (PyObject*)self;
+    if (encoder_set_charset(self->encoder, charset) != 0) {
+        if (!PyErr_Occurred()) {
+            PyErr_Format(PyExc_ValueError, "Unsupported session charset '%s'.", charset);
+        }
+        return -1;
+    }
+    if ((self->conn = teradata_connect(host, username, password, logon_mech, logon_mech_data,
+            encoder_charset_name(self->encoder))) == NULL) {
+        return -1;
+    }
     return 0;
 }
 
@@ -159,6 +170,9 @@ static PyObject* Cmd_set_encoding(Cmd *self, PyObject *args) {
     if (settings & DECIMAL_RETURN_MASK) {
         new_settings = (self->encoder->Settings & ~DECIMAL_RETURN_MASK) | (settings & DECIMAL_RETURN_MASK);
     }
+    if (settings & STRING_RETURN_MASK) {
+        new_settings = (self->encoder->Settings & ~STRING_RETURN_MASK) | (settings & STRING_RETURN_MASK);
+    }
     if (encoder_set_encoding(self->encoder, new_settings) != 0) {
         PyErr_Format(PyExc_ValueError, "Encoder set_encoding failed, bad encoding '0x%06x'.", settings);
         return NULL;
@@ -242,8 +256,9 @@ static int Encoder_init(Encoder *self, PyObject *args, PyObject *kwargs) {
     PyObject *columns_obj;
     GiraffeColumns *columns;
     uint32_t settings = ENCODER_SETTINGS_DEFAULT;
-    static char *kwlist[] = {"columns_obj", "settings", NULL};
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|i", kwlist, &columns_obj, &settings)) {
+    char *charset = NULL;
+    static char *kwlist[] = {"columns_obj", "settings", "charset", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|iz", kwlist, &columns_obj, &settings, &charset)) {
         return -1;
     }
     columns = giraffez_columns_from_pyobject(columns_obj);
@@ -256,6 +271,13 @@ static int Encoder_init(Encoder *self, PyObject *args, PyObject *kwargs) {
         PyErr_SetString(PyExc_ValueError, "Could not create encoder. Bad settings. Bad person.");
         return -1;
     }
+    self->encoder->Owner = (PyObject*)self;
+    if (encoder_set_charset(self->encoder, charset) != 0) {
+        if (!PyErr_Occurred()) {
+            PyErr_Format(PyExc_ValueError, "Unsupported session charset '%s'.", charset);
+        }
+        return -1;
+    }
     return 0;
 }
 
@@ -283,6 +305,50 @@ static PyObject* Encoder_pack_row(Encoder *self, PyObject *args) {
     return PyBytes_FromStringAndSize((char*)self->encoder->buffer->data, length);
 }
 
+// The state returned with each buffer is None once rows is exhausted,
+// otherwise (index, row) where index is the position of the next row and
+// row the packed row that did not fit in max_bytes (or None).  It is
+// passed back with the same iterator to continue.
+static PyObject* Encoder_pack_rows(Encoder *self, PyObject *args, PyObject *kwargs) {
+    PyObject *rows, *iter, *errors, *data, *state = Py_None, *held = NULL;
+    Py_ssize_t max_bytes = 0, index = 0;
+    static char *kwlist[] = {"rows", "max_bytes", "state", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|nO", kwlist, &rows, &max_bytes, &state)) {
+        return NULL;
+    }
+    if (max_bytes < 0) {
+        PyErr_SetString(PyExc_ValueError, "max_bytes must not be negative.");
+        return NULL;
+    }
+    if (state != Py_None) {
+        if (!PyTuple_Check(state) || !PyArg_ParseTuple(state, "nO", &index, &held)) {
+            PyErr_SetString(PyExc_TypeError, "state must be a state returned by pack_rows.");
+            return NULL;
+        }
+        if (held == Py_None) {
+            held = NULL;
+        } else if (!PyBytes_Check(held) || PyBytes_GET_SIZE(held) < (Py_ssize_t)sizeof(uint16_t)) {
+            PyErr_SetString(PyExc_TypeError, "state must be a state returned by pack_rows.");
+            return NULL;
+        }
+    }
+    Py_RETURN_ERROR(iter = PyObject_GetIter(rows));
+    if ((errors = PyList_New(0)) == NULL) {
+        Py_DECREF(iter);
+        return NULL;
+    }
+    data = teradata_buffer_from_pyiter(self->encoder, iter, (size_t)max_bytes, &held, &index, errors);
+    Py_DECREF(iter);
+    if (data == NULL) {
+        Py_DECREF(errors);
+        return NULL;
+    }
+    if (held == NULL) {
+        return Py_BuildValue("(NNO)", data, errors, Py_None);
+    }
+    return Py_BuildValue("(NN(nN))", data, errors, index, held);
+}
+
 static PyObject* Encoder_set_encoding(Encoder *self, PyObject *args) {
     uint32_t settings;
     if (!PyArg_ParseTuple(args, "i", &settings)) {
@@ -306,7 +372,10 @@ static PyObject* Encoder_set_columns(Encoder *self, PyObject *args) {
         PyErr_SetString(PyExc_ValueError, "No columns found.");
         return NULL;
     }
-    self->encoder->Columns = columns;
+    encoder_clear(self->encoder);
+    if (encoder_set_columns(self->encoder, columns) != 0) {
+        return PyErr_NoMemory();
+    }
     Py_RETURN_NONE;
 }
 
@@ -315,8 +384,7 @@ static PyObject* Encoder_set_delimiter(Encoder *self, PyObject *args) {
     if (!PyArg_ParseTuple(args, "O", &obj)) {
         return NULL;
     }
-    encoder_set_delimiter(self->encoder, obj);
-    Py_RETURN_NONE;
+    return encoder_set_delimiter(self->encoder, obj);
 }
 
 static PyObject* Encoder_set_null(Encoder *self, PyObject *args) {
@@ -324,8 +392,7 @@ static PyObject* Encoder_set_null(Encoder *self, PyObject *args) {
     if (!PyArg_ParseTuple(args, "O", &obj)) {
         return NULL;
     }
-    encoder_set_null(self->encoder, obj);
-    Py_RETURN_NONE;
+    return encoder_set_null(self->encoder, obj);
 }
 
 static PyObject* Encoder_unpack_row(Encoder *self, PyObject *args) {
@@ -339,6 +406,30 @@ static PyObject* Encoder_unpack_row(Encoder *self, PyObject *args) {
     return row;
 }
 
+static PyObject* Encoder_unpack_row_at(Encoder *self, PyObject *args) {
+    Py_buffer buffer;
+    PyObject *row;
+    uint32_t index;
+    if (!PyArg_ParseTuple(args, "s*I", &buffer, &index)) {
+        return NULL;
+    }
+    row = teradata_buffer_row_at(self->encoder, (unsigned char**)&buffer.buf, buffer.len, index);
+    PyBuffer_Release(&buffer);
+    return row;
+}
+
+static PyObject* Encoder_unpack_column(Encoder *self, PyObject *args) {
+    Py_buffer buffer;
+    PyObject *values;
+    uint32_t index;
+    if (!PyArg_ParseTuple(args, "s*I", &buffer, &index)) {
+        return NULL;
+    }
+    values = teradata_buffer_column_at(self->encoder, (unsigned char**)&buffer.buf, buffer.len, index);
+    PyBuffer_Release(&buffer);
+    return values;
+}
+
 static PyObject* Encoder_unpack_rows(Encoder *self, PyObject *args) {
     Py_buffer buffer;
     PyObject *rows;
@@ -350,6 +441,17 @@ static PyObject* Encoder_unpack_rows(Encoder *self, PyObject *args) {
     return rows;
 }
 
+static PyObject* Encoder_unpack_rows_arrow(Encoder *self, PyObject *args) {
+    Py_buffer buffer;
+    PyObject *batch;
+    if (!PyArg_ParseTuple(args, "s*", &buffer)) {
+        return NULL;
+    }
+    batch = teradata_buffer_to_arrow(self->encoder, (unsigned char**)&buffer.buf, buffer.len);
+    PyBuffer_Release(&buffer);
+    return batch;
+}
+
 static PyObject* Encoder_unpack_stmt_info(PyObject *self, PyObject *args) {
     Py_buffer buffer;
     GiraffeColumns *columns;
@@ -364,12 +466,16 @@ static PyObject* Encoder_unpack_stmt_info(PyObject *self, PyObject *args) {
 static PyMethodDef Encoder_methods[] = {
     {"count_rows", (PyCFunction)Encoder_count_rows, METH_STATIC|METH_VARARGS, ""},
     {"pack_row", (PyCFunction)Encoder_pack_row, METH_VARARGS, ""},
+    {"pack_rows", (PyCFunction)Encoder_pack_rows, METH_VARARGS|METH_KEYWORDS, ""},
     {"set_columns", (PyCFunction)Encoder_set_columns, METH_VARARGS, ""},
     {"set_delimiter", (PyCFunction)Encoder_set_delimiter, METH_VARARGS, ""},
     {"set_encoding", (PyCFunction)Encoder_set_encoding, METH_VARARGS, ""},
     {"set_null", (PyCFunction)Encoder_set_null, METH_VARARGS, ""},
+    {"unpack_column", (PyCFunction)Encoder_unpack_column, METH_VARARGS, ""},
     {"unpack_row", (PyCFunction)Encoder_unpack_row, METH_VARARGS, ""},
+    {"unpack_row_at", (PyCFunction)Encoder_unpack_row_at, METH_VARARGS, ""},
     {"unpack_rows", (PyCFunction)Encoder_unpack_rows, METH_VARARGS, ""},
+    {"unpack_rows_arrow", (PyCFunction)Encoder_unpack_rows_arrow, METH_VARARGS, ""},
     {"unpack_stmt_info", (PyCFunction)Encoder_unpack_stmt_info, METH_STATIC|METH_VARARGS, ""},
     {NULL}  /* Sentinel */
 };
@@ -496,6 +602,18 @@ MOD_INIT(_teradata)
         return MOD_ERROR_VAL;
     }
 
+    if (PyType_Ready(&ColumnBufferType) < 0) {
+        return MOD_ERROR_VAL;
+    }
+
+    if (PyType_Ready(&RecordType) < 0) {
+        return MOD_ERROR_VAL;
+    }
+
+    if (PyType_Ready(&LazyRecordType) < 0) {
+        return MOD_ERROR_VAL;
+    }
+
 #if PY_MAJOR_VERSION >= 3
     m = PyModule_Create(&moduledef);
 #else
@@ -523,6 +641,12 @@ MOD_INIT(_teradata)
     PyModule_AddObject(m, "Cmd", (PyObject*)&CmdType);
     Py_INCREF(&EncoderType);
     PyModule_AddObject(m, "Encoder", (PyObject*)&EncoderType);
+    Py_INCREF(&ColumnBufferType);
+    PyModule_AddObject(m, "ColumnBuffer", (PyObject*)&ColumnBufferType);
+    Py_INCREF(&RecordType);
+    PyModule_AddObject(m, "Record", (PyObject*)&RecordType);
+    Py_INCREF(&LazyRecordType);
+    PyModule_AddObject(m, "LazyRecord", (PyObject*)&LazyRecordType);
     return MOD_SUCCESS_VAL(m);
 }
 
@@ -50,6 +50,7 @@ static int Export_init(Export *self, PyObject *args, PyObject *kwargs) {
     }
 
     self->conn = new Giraffez::Connection(host, username, password, logon_mech, logon_mech_data);
+    self->conn->encoder->Owner = (PyObject*)self;
     if (logon_mech != NULL) {
         self->conn->AddAttribute(TD_LOGON_MECH, logon_mech);
         if (logon_mech_data != NULL) {
@@ -122,6 +123,10 @@ static PyObject* Export_get_buffer(Export *self) {
     return self->conn->GetBuffer();
 }
 
+static PyObject* Export_get_arrow_batch(Export *self) {
+    return self->conn->GetArrowBatch();
+}
+
 static PyObject* Export_get_event(Export *self, PyObject *args, PyObject *kwargs) {
     TD_EventType event_type;
     TD_Index event_index = 0;
@@ -147,6 +152,9 @@ static PyObject* Export_set_encoding(Export *self, PyObject *args) {
     if (settings & DECIMAL_RETURN_MASK) {
         new_settings = (new_settings & ~DECIMAL_RETURN_MASK) | settings;
     }
+    if (settings & STRING_RETURN_MASK) {
+        new_settings = (new_settings & ~STRING_RETURN_MASK) | settings;
+    }
     if (encoder_set_encoding(self->conn->encoder, new_settings) != 0) {
         PyErr_Format(PyExc_ValueError, "Encoder set_encoding failed, bad encoding '0x%06x'.", settings);
         return NULL;
@@ -193,6 +201,7 @@ static PyMethodDef Export_methods[] = {
     {"add_attribute", (PyCFunction)Export_add_attribute, METH_VARARGS, ""},
     {"close", (PyCFunction)Export_close, METH_NOARGS, ""},
     {"columns", (PyCFunction)Export_columns, METH_NOARGS, ""},
+    {"get_arrow_batch", (PyCFunction)Export_get_arrow_batch, METH_NOARGS, ""},
     {"get_buffer", (PyCFunction)Export_get_buffer, METH_NOARGS, ""},
     {"get_event", (PyCFunction)Export_get_event, METH_VARARGS, ""},
     {"initiate", (PyCFunction)Export_initiate, METH_NOARGS, ""},
@@ -351,6 +360,9 @@ static PyObject* MLoad_set_encoding(MLoad *self, PyObject *args, PyObject *kwarg
     if (settings & DECIMAL_RETURN_MASK) {
         new_settings = (self->conn->encoder->Settings & ~DECIMAL_RETURN_MASK) | settings;
     }
+    if (settings & STRING_RETURN_MASK) {
+        new_settings = (self->conn->encoder->Settings & ~STRING_RETURN_MASK) | settings;
+    }
     if (encoder_set_encoding(self->conn->encoder, new_settings) != 0) {
         PyErr_Format(PyExc_ValueError, "Encoder set_encoding failed, bad encoding '0x%06x'.", settings);
         return NULL;
@@ -531,6 +543,18 @@ MOD_INIT(_teradatapt)
         return MOD_ERROR_VAL;
     }
 
+    if (PyType_Ready(&ColumnBufferType) < 0) {
+        return MOD_ERROR_VAL;
+    }
+
+    if (PyType_Ready(&RecordType) < 0) {
+        return MOD_ERROR_VAL;
+    }
+
+    if (PyType_Ready(&LazyRecordType) < 0) {
+        return MOD_ERROR_VAL;
+    }
+
     MOD_DEF(m, "_teradatapt", "", module_methods);
 
     giraffez_types_import();
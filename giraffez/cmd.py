@@ -55,11 +55,14 @@ class Cursor(object):
         automatically into Python floats
     :param bool parse_dates: Returns date/time types as giraffez
         date/time types (instead of Python strings)
+    :param bool intern_strings: Share one string object between repeated
+        values of CHAR/VARCHAR columns
+    :param bool trim_char: Remove the trailing space padding of CHAR values
     """
 
     def __init__(self, conn, command, multi_statement=False, header=False,
             prepare_only=False, coerce_floats=True, parse_dates=False,
-            panic=True):
+            panic=True, intern_strings=False, trim_char=False):
         self.conn = conn
         self.command = command
         self.multi_statement = multi_statement
@@ -74,6 +77,10 @@ class Cursor(object):
             self.conn.set_encoding(DECIMAL_AS_STRING)
         if self.parse_dates:
             self.conn.set_encoding(DATETIME_AS_GIRAFFE_TYPES)
+        strings = STRING_AS_INTERNED if intern_strings else STRING_AS_NEW
+        if trim_char:
+            strings |= STRING_TRIM_CHAR
+        self.conn.set_encoding(strings)
         self.columns = None
         if self.multi_statement:
             self.statements = [Statement(command)]
@@ -191,6 +198,27 @@ class Cursor(object):
         self.processor = lambda x, y: y
         return self
 
+    def to_lazy(self):
+        """
+        Sets the current encoder output to lazy row objects and returns
+        the cursor.  Lazy rows support the same access as the default
+        rows, but only decode a value when it is first accessed, which
+        saves decoding the columns of rows that are filtered out:
+
+        .. code-block:: python
+
+            with giraffez.Cmd() as cmd:
+                for row in cmd.execute(query).to_lazy():
+                    if row.state == "VA":
+                        print(row.items())
+
+        Values have to be accessed before the next statement of the
+        cursor is read.
+        """
+        self.conn.set_encoding(ROW_ENCODING_LAZY)
+        self.processor = lambda x, y: y
+        return self
+
     def to_list(self):
         """
         Set the current encoder output to :class:`giraffez.Row` objects
@@ -202,6 +230,25 @@ class Cursor(object):
         self.processor = lambda x, y: Row(x, y)
         return self
 
+    def to_record(self):
+        """
+        Sets the current encoder output to compact row objects created by
+        the encoder and returns the cursor.  Records are accessed by
+        index, by column name and as attributes like
+        :class:`giraffez.Row`, but are not instances of it: the keys of
+        :meth:`items` are the column titles used by :meth:`to_dict`, and
+        there are no :code:`columns` or :code:`row` attributes.
+
+        .. code-block:: python
+
+            with giraffez.Cmd() as cmd:
+                for row in cmd.execute(query).to_record():
+                    print(row.state, row[0])
+        """
+        self.conn.set_encoding(ROW_ENCODING_RECORD)
+        self.processor = lambda x, y: y
+        return self
+
     def next(self):
         return self.__next__()
 
@@ -247,8 +294,12 @@ class TeradataCmd(Connection):
     :param string silent: Suppress log output. Used internally only.
     :param bool panic: If :code:`True`, when an error is encountered it will be
         raised.
+    :param str charset: The session character set, either :code:`"UTF8"` (default)
+        or :code:`"LATIN1"`.  Strings are decoded according to the session charset,
+        and LATIN1 decodes faster when the data does not require Unicode.
     :raises `giraffez.errors.InvalidCredentialsError`: if the supplied credentials are incorrect
     :raises `giraffez.TeradataError`: if the connection cannot be established
+    :raises `ValueError`: if the charset is not supported
 
     Meant to be used, where possible, with python's :code:`with` context handler
     to guarantee that connections will be closed gracefully when operation
@@ -264,14 +315,16 @@ class TeradataCmd(Connection):
     """
 
     def __init__(self, host=None, username=None, password=None, log_level=INFO, config=None,
-            key_file=None, dsn=None, protect=False, silent=False, panic=True):
+            key_file=None, dsn=None, protect=False, silent=False, panic=True, charset=None):
+        self.charset = charset.upper() if charset else None
         super(TeradataCmd, self).__init__(host, username, password, log_level, config, key_file,
             dsn, protect, silent=silent)
         self.panic = panic
         self.silent = silent
 
     def execute(self, command, coerce_floats=True, parse_dates=False, header=False, sanitize=True,
-            silent=False, panic=None,  multi_statement=False, prepare_only=False):
+            silent=False, panic=None,  multi_statement=False, prepare_only=False, intern_strings=False,
+            trim_char=False):
         """
         Execute commands using CLIv2.
 
@@ -286,6 +339,11 @@ class TeradataCmd(Connection):
             raised.
         :param bool multi_statement: Execute in multi-statement mode
         :param bool prepare_only: Only prepare the command (no results)
+        :param bool intern_strings: Share one string object between repeated values of
+            CHAR/VARCHAR columns.  Meant for low-cardinality columns (codes, flags),
+            columns where values rarely repeat stop being cached automatically.
+        :param bool trim_char: Remove the trailing space padding of CHAR values, which in
+            UTF8 sessions is up to 3 times the declared length of the column
         :return: a cursor over the results of each statement in the command
         :rtype: :class:`~giraffez.cmd.Cursor`
         :raises `giraffez.TeradataError`: if the query is invalid
@@ -313,7 +371,7 @@ class TeradataCmd(Connection):
         self.cmd.set_encoding(ENCODER_SETTINGS_DEFAULT)
         return Cursor(self.cmd, command, multi_statement=multi_statement, header=header,
             prepare_only=prepare_only, coerce_floats=coerce_floats, parse_dates=parse_dates,
-            panic=panic)
+            panic=panic, intern_strings=intern_strings, trim_char=trim_char)
 
     def exists(self, object_name, silent=False):
         """
@@ -399,7 +457,7 @@ class TeradataCmd(Connection):
             self.cmd.close()
 
     def _connect(self, host, username, password, logon_mech, logon_mech_data):
-        self.cmd = _Cmd(host, username, password, logon_mech, logon_mech_data)
+        self.cmd = _Cmd(host, username, password, logon_mech, logon_mech_data, charset=self.charset)
 
     def _insert(self, table_name, rows, fields=None, parse_dates=False):
         global _columns_cache
@@ -911,10 +911,10 @@ gd_type_map = {
     TIME_N: GD_TIME,
     TIMESTAMP_NN: GD_TIMESTAMP,
     TIMESTAMP_N: GD_TIMESTAMP,
-    TIME_NNZ: GD_CHAR,
-    TIME_NZ: GD_CHAR,
-    TIMESTAMP_NNZ: GD_CHAR,
-    TIMESTAMP_NZ: GD_CHAR,
+    TIME_NNZ: GD_TIME,
+    TIME_NZ: GD_TIME,
+    TIMESTAMP_NNZ: GD_TIMESTAMP,
+    TIMESTAMP_NZ: GD_TIMESTAMP,
     INTERVAL_YEAR_NN: GD_DEFAULT,
     INTERVAL_YEAR_N: GD_DEFAULT,
     INTERVAL_YEAR_TO_MONTH_NN: GD_DEFAULT,
@@ -965,19 +965,30 @@ ROW_ENCODING_STRING   = 0x01
 ROW_ENCODING_DICT     = 0x02
 ROW_ENCODING_LIST     = 0x04
 ROW_ENCODING_RAW      = 0x08
+ROW_ENCODING_COLUMNAR = 0x10
+ROW_ENCODING_RECORD   = 0x20
+ROW_ENCODING_LAZY     = 0x40
 ROW_RETURN_MASK       = 0xff
 
 DATETIME_AS_INVALID        = 0x0000
 DATETIME_AS_STRING         = 0x0100
 DATETIME_AS_GIRAFFE_TYPES  = 0x0200
+DATETIME_AS_PYDATETIME     = 0x0400
+DATETIME_AS_EPOCH          = 0x0800
 DATETIME_RETURN_MASK       = 0xff00
 
 DECIMAL_AS_INVALID          = 0x000000
 DECIMAL_AS_STRING           = 0x010000
 DECIMAL_AS_FLOAT            = 0x020000
 DECIMAL_AS_GIRAFFEZ_DECIMAL = 0x040000
+DECIMAL_AS_SCALED_INT       = 0x080000
 DECIMAL_RETURN_MASK         = 0xff0000
 
+STRING_AS_NEW         = 0x01000000
+STRING_AS_INTERNED    = 0x02000000
+STRING_TRIM_CHAR      = 0x10000000
+STRING_RETURN_MASK    = 0xff000000
+
 ENCODER_SETTINGS_DEFAULT = ROW_ENCODING_LIST | DATETIME_AS_STRING | DECIMAL_AS_FLOAT
 ENCODER_SETTINGS_STRING  = ROW_ENCODING_STRING | DATETIME_AS_STRING | DECIMAL_AS_STRING
 ENCODER_SETTINGS_JSON    = ROW_ENCODING_DICT | DATETIME_AS_STRING | DECIMAL_AS_FLOAT
@@ -988,10 +999,18 @@ encoder_settings_map = {
     0x02: 'ROW_ENCODING_DICT',
     0x04: 'ROW_ENCODING_LIST',
     0x08: 'ROW_ENCODING_RAW',
-    0x08: 'ROW_ENCODING_RAW',
+    0x10: 'ROW_ENCODING_COLUMNAR',
+    0x20: 'ROW_ENCODING_RECORD',
+    0x40: 'ROW_ENCODING_LAZY',
     0x0100: 'DATETIME_AS_STRING',
     0x0200: 'DATETIME_AS_GIRAFFE_TYPES',
+    0x0400: 'DATETIME_AS_PYDATETIME',
+    0x0800: 'DATETIME_AS_EPOCH',
     0x010000: 'DECIMAL_AS_STRING',
     0x020000: 'DECIMAL_AS_FLOAT',
     0x040000: 'DECIMAL_AS_GIRAFFEZ_DECIMAL',
+    0x080000: 'DECIMAL_AS_SCALED_INT',
+    0x01000000: 'STRING_AS_NEW',
+    0x02000000: 'STRING_AS_INTERNED',
+    0x10000000: 'STRING_TRIM_CHAR',
 }
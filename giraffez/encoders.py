@@ -35,6 +35,29 @@ from ._compat import *
 
 
 
+class ArrowBatch(object):
+    """
+    A batch of rows exported through the Apache Arrow C Data Interface.
+
+    Implements the Arrow PyCapsule protocol (:code:`__arrow_c_array__`) so
+    that it can be imported zero-copy by pyarrow, polars, duckdb and other
+    Arrow consumers, for example :code:`pyarrow.record_batch(batch)`.  The
+    batch is a struct array with one child per column and may only be
+    imported once.
+    """
+
+    __slots__ = ('_capsules',)
+
+    def __init__(self, capsules):
+        self._capsules = capsules
+
+    def __arrow_c_array__(self, requested_schema=None):
+        if self._capsules is None:
+            raise GiraffeError("Arrow batch has already been imported")
+        capsules, self._capsules = self._capsules, None
+        return capsules
+
+
 class TeradataEncoder(object):
     """
     The class wrapping the Teradata C encoder.
@@ -43,13 +66,16 @@ class TeradataEncoder(object):
 
     :param list or :class:`giraffez.Columns` columns: Columns used for encoding.
     :param int encoding: Constant value representing the settings used by underlying C encoder.
+    :param str charset: The session character set of the data, either :code:`"UTF8"`
+        (default) or :code:`"LATIN1"`.
     """
-    def __init__(self, columns=[], encoding=None):
+    def __init__(self, columns=[], encoding=None, charset=None):
         self.encoding = ENCODER_SETTINGS_DEFAULT
+        self.charset = charset.upper() if charset else None
         self._columns = columns
         self._delimiter = '|'
         self._null = None
-        self.encoder = Encoder(columns)
+        self.encoder = Encoder(columns, ENCODER_SETTINGS_DEFAULT, self.charset)
         if encoding is not None:
             self |= encoding
 
@@ -74,8 +100,8 @@ class TeradataEncoder(object):
 
     @delimiter.setter
     def delimiter(self, value):
+        self.encoder.set_delimiter(value)
         self._delimiter = value
-        self.encoder.set_delimiter(self._delimtier)
 
     @property
     def null(self):
@@ -83,8 +109,8 @@ class TeradataEncoder(object):
 
     @null.setter
     def null(self, value):
+        self.encoder.set_null(value)
         self._null = value
-        self.encoder.set_null(self._null)
 
     def parse_header(self, data):
         return self.encoder.unpack_stmt_info(data)
@@ -92,12 +118,57 @@ class TeradataEncoder(object):
     def read(self, data):
         return self.encoder.unpack_row(data)
 
+    def read_at(self, data, index):
+        return self.encoder.unpack_row_at(data, index)
+
     def readbuffer(self, data):
         return self.encoder.unpack_rows(data)
 
+    def readbuffer_arrow(self, data):
+        return ArrowBatch(self.encoder.unpack_rows_arrow(data))
+
+    def readcolumn(self, data, column):
+        if isinstance(column, basestring):
+            column = self.columns.names.index(column.lower())
+        return self.encoder.unpack_column(data, column)
+
     def serialize(self, data):
         return self.encoder.pack_row(data)
 
+    def serializebuffer(self, rows):
+        """
+        Packs rows into a single buffer of length-prefixed rows, the layout
+        read by :meth:`readbuffer` and used by giraffez archive files.
+
+        Rows that cannot be packed are left out and returned as a list of
+        :code:`(index, error)`, the index being the position of the row in
+        :code:`rows`.
+
+        :param iterable rows: The rows, of any type accepted by :meth:`serialize`
+        :rtype: tuple (``bytes``, ``list``)
+        """
+        data, errors, _ = self.encoder.pack_rows(rows)
+        return data, errors
+
+    def serializebuffers(self, rows, max_bytes):
+        """
+        Packs rows into buffers no larger than :code:`max_bytes`, as
+        :meth:`serializebuffer` does.  The index of the errors of each
+        buffer is the position of the row in :code:`rows`.
+
+        :param iterable rows: The rows, of any type accepted by :meth:`serialize`
+        :param int max_bytes: The maximum size of each buffer
+        :rtype: iterator (yields tuple (``bytes``, ``list``))
+        """
+        rows = iter(rows)
+        state = None
+        while True:
+            data, errors, state = self.encoder.pack_rows(rows, max_bytes, state)
+            if data or errors:
+                yield data, errors
+            if state is None:
+                return
+
     def setdefaults(self):
         self.encoding = ENCODER_SETTINGS_DEFAULT
         self.encoder.set_encoding(self.encoding)
@@ -109,6 +180,8 @@ class TeradataEncoder(object):
             self.encoding = self.encoding & ~DATETIME_RETURN_MASK | other
         if other & DECIMAL_RETURN_MASK:
             self.encoding = self.encoding & ~DECIMAL_RETURN_MASK | other
+        if other & STRING_RETURN_MASK:
+            self.encoding = self.encoding & ~STRING_RETURN_MASK | other
         self.encoder.set_encoding(self.encoding)
         self.encoder.set_delimiter(self._delimiter)
         self.encoder.set_null(self._null)
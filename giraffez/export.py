@@ -25,7 +25,7 @@ from .errors import *
 from ._teradatapt import InvalidCredentialsError
 from .config import Config
 from .connection import Connection, Context
-from .encoders import dict_to_json, TeradataEncoder
+from .encoders import dict_to_json, ArrowBatch, TeradataEncoder
 from .fmt import truncate
 from .logging import log
 from .sql import parse_statement, remove_curly_quotes
@@ -61,6 +61,11 @@ class TeradataBulkExport(Connection):
         command :code:`giraffez config --unlock <connection>` changing the connection password,
         or via the :meth:`~giraffez.config.Config.unlock_connection` method.
     :param bool coerce_floats: Coerce Teradata decimal types into Python floats
+    :param bool intern_strings: Share one string object between repeated values of
+        CHAR/VARCHAR columns.  Meant for low-cardinality columns (codes, flags),
+        columns where values rarely repeat stop being cached automatically.
+    :param bool trim_char: Remove the trailing space padding of CHAR values, which in
+        UTF8 sessions is up to 3 times the declared length of the column
     :raises `giraffez.errors.InvalidCredentialsError`: if the supplied credentials are incorrect
     :raises `giraffez.TeradataError`: if the connection cannot be established
 
@@ -78,12 +83,14 @@ class TeradataBulkExport(Connection):
 
     def __init__(self, query=None, host=None, username=None, password=None,
             log_level=INFO, config=None, key_file=None, dsn=None, protect=False,
-            coerce_floats=True):
+            coerce_floats=True, intern_strings=False, trim_char=False):
         super(TeradataBulkExport, self).__init__(host, username, password, log_level, config, key_file,
             dsn, protect)
         # Attributes used with property getter/setters
         self._query = None
         self.coerce_floats = coerce_floats
+        self.intern_strings = intern_strings
+        self.trim_char = trim_char
         self.initiated = False
         #: The amount of time spent in idle (waiting for server)
         self.idle_time = 0
@@ -174,6 +181,53 @@ class TeradataBulkExport(Connection):
             writer.write(chunk)
             yield TeradataEncoder.count(chunk)
 
+    def to_arrow(self):
+        """
+        Returns an iterator of :class:`~giraffez.encoders.ArrowBatch`
+        objects, one per buffer received from Teradata, which can be
+        imported zero-copy using the Apache Arrow C Data Interface:
+
+        .. code-block:: python
+
+            with giraffez.BulkExport("database.table_name") as export:
+                table = pyarrow.Table.from_batches(
+                    pyarrow.record_batch(b) for b in export.to_arrow())
+
+        :rtype: iterator (yields :class:`~giraffez.encoders.ArrowBatch`)
+        """
+        if self.query is None:
+            raise GiraffeError("Must set target table or query.")
+        if not self.initiated:
+            self._initiate()
+        while True:
+            data = self.export.get_arrow_batch()
+            if data is None:
+                return
+            yield ArrowBatch(data)
+
+    def to_columns(self):
+        """
+        Sets the current encoder output to columnar batches and returns
+        a batch iterator.  Each batch is a `dict` mapping column names to
+        :code:`giraffez._teradata.ColumnBuffer` objects, which expose
+        their values through the buffer protocol (e.g. :code:`numpy.frombuffer`)
+        and carry :code:`validity` (Arrow-style bitmap) and, for variable
+        length types, :code:`offsets` buffers.  Strings are UTF-8
+        encoded whatever the session charset is.
+
+        :rtype: iterator (yields ``dict``)
+        """
+        if self.query is None:
+            raise GiraffeError("Must set target table or query.")
+        if not self.initiated:
+            self._initiate()
+        self.export.set_encoding(ROW_ENCODING_COLUMNAR)
+        while True:
+            data = self.export.get_buffer()
+            if not data:
+                return
+            yield data
+
     def to_dict(self):
         """
         Sets the current encoder output to Python `dict` and returns
@@ -192,6 +246,17 @@ class TeradataBulkExport(Connection):
         """
         return self._fetchall(ROW_ENCODING_DICT, processor=dict_to_json)
 
+    def to_lazy(self):
+        """
+        Sets the current encoder output to lazy row objects and returns
+        a row iterator.  Rows hold a reference to the buffer they were
+        read from and only decode a value when it is first accessed
+        (by index, column name or attribute).
+
+        :rtype: iterator (yields row objects)
+        """
+        return self._fetchall(ROW_ENCODING_LAZY)
+
     def to_list(self):
         """
         Sets the current encoder output to Python `list` and returns
@@ -252,6 +317,10 @@ class TeradataBulkExport(Connection):
             self.export.set_encoding(DECIMAL_AS_FLOAT)
         else:
             self.export.set_encoding(DECIMAL_AS_STRING)
+        strings = STRING_AS_INTERNED if self.intern_strings else STRING_AS_NEW
+        if self.trim_char:
+            strings |= STRING_TRIM_CHAR
+        self.export.set_encoding(strings)
         while True:
             try:
                 data = self.export.get_buffer()
@@ -17,6 +17,7 @@
 import time
 import struct
 import threading
+import warnings
 
 from ._teradatapt import EncoderError, InvalidCredentialsError, MLoad, TeradataError as TeradataPTError
 
@@ -25,7 +26,7 @@ from .errors import *
 
 from .cmd import TeradataCmd
 from .connection import Connection, Context
-from .encoders import DateHandler, null_handler
+from .encoders import null_handler
 from .fmt import format_table
 from .io import ArchiveFileReader, CSVReader, FileReader, JSONReader, Reader
 from .logging import log
@@ -200,7 +201,7 @@ class TeradataBulkLoad(Connection):
         return self.exit_code
 
     def from_file(self, filename, table=None, delimiter='|', null='NULL',
-            panic=True, quotechar='"', parse_dates=False):
+            panic=True, quotechar='"', parse_dates=None):
         """
         Load from a file into the target table, handling each step of the
         load process.
@@ -229,6 +230,12 @@ class TeradataBulkLoad(Connection):
         :param bool panic: If :code:`True`, when an error is encountered it will be
             raised. Otherwise, the error will be logged and :code:`self.error_count`
             is incremented.
+        :param bool parse_dates: Deprecated and ignored, dates are always parsed
+            while encoding. DATE values may be ISO dates (YYYY-MM-DD), YYYYMMDD,
+            MM/DD/YYYY or Teradata integer dates, the format of each column is
+            detected from its first value. TIME and TIMESTAMP values that cannot
+            be parsed are sent as text, as they were before, for Teradata to
+            accept or reject.
         :return: The output of the call to
             :meth:`~giraffez.load.TeradataBulkLoad.finish`
         :raises `giraffez.errors.GiraffeError`: if table was not set and :code:`table`
@@ -236,6 +243,9 @@ class TeradataBulkLoad(Connection):
         :raises `giraffez.errors.GiraffeEncodeError`: if :code:`panic` is :code:`True` and there
             are format errors in the row values.
         """
+        if parse_dates is not None:
+            warnings.warn("parse_dates is deprecated and has no effect, dates are always "
+                "parsed while encoding", DeprecationWarning, stacklevel=2)
         if not self.table:
             if not table:
                 raise GiraffeError("Table must be set or specified to load a file.")
@@ -249,8 +259,6 @@ class TeradataBulkLoad(Connection):
             if isinstance(f, ArchiveFileReader):
                 self.mload.set_encoding(ROW_ENCODING_RAW)
                 self.preprocessor = lambda s: s
-            if parse_dates:
-                self.preprocessor = DateHandler(self.columns)
             self._initiate()
             self.mload.set_null(null)
             self.mload.set_delimiter(delimiter)
@@ -53,6 +53,7 @@
           ob = PyModule_Create(&moduledef);
 
   #define Py_TPFLAGS_HAVE_ITER 0
+  #define Py_TPFLAGS_HAVE_NEWBUFFER 0
   #define MOD_ERROR_VAL NULL
   #define PyStr_Check(ob) PyUnicode_Check(ob)
   #define _PyLong_Check(ob) PyLong_Check(ob)
@@ -0,0 +1,389 @@
+/*
+ * Copyright 2016 Capital One Services, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common.h"
+#include "columnar.h"
+#include "columns.h"
+#include "convert.h"
+#include "encoder.h"
+
+#include "arrow.h"
+
+
+#define ARROW_FORMAT_SIZE 32
+
+// Each ArrowArray keeps a reference to the ColumnBuffer objects that own
+// the memory it points to, so that children moved out of the parent by a
+// consumer stay valid after the parent has been released.
+typedef struct {
+    PyObject   *owner;
+    const void *buffers[3];
+} ArrowArrayPrivate;
+
+static void arrow_schema_release(struct ArrowSchema *schema) {
+    int64_t i;
+    for (i=0; i<schema->n_children; i++) {
+        if (schema->children[i] == NULL) {
+            continue;
+        }
+        if (schema->children[i]->release != NULL) {
+            schema->children[i]->release(schema->children[i]);
+        }
+        free(schema->children[i]);
+    }
+    free(schema->children);
+    free((char*)schema->format);
+    free((char*)schema->name);
+    schema->release = NULL;
+}
+
+static void arrow_array_release(struct ArrowArray *array) {
+    PyGILState_STATE state;
+    ArrowArrayPrivate *p = (ArrowArrayPrivate*)array->private_data;
+    int64_t i;
+    for (i=0; i<array->n_children; i++) {
+        if (array->children[i] == NULL) {
+            continue;
+        }
+        if (array->children[i]->release != NULL) {
+            array->children[i]->release(array->children[i]);
+        }
+        free(array->children[i]);
+    }
+    free(array->children);
+    // Consumers may release the array from any thread
+    if (p->owner != NULL) {
+        state = PyGILState_Ensure();
+        Py_DECREF(p->owner);
+        PyGILState_Release(state);
+    }
+    free(p);
+    array->release = NULL;
+}
+
+// On failure the schema is left without children but can still be
+// released.
+static int arrow_schema_init(struct ArrowSchema *schema, const char *format, const char *name,
+        const int64_t flags, const int64_t n_children) {
+    schema->format = strdup(format);
+    schema->name = strdup(name);
+    schema->metadata = NULL;
+    schema->flags = flags;
+    schema->n_children = n_children;
+    schema->children = (struct ArrowSchema**)calloc(n_children > 0 ? n_children : 1,
+        sizeof(struct ArrowSchema*));
+    schema->dictionary = NULL;
+    schema->release = arrow_schema_release;
+    schema->private_data = NULL;
+    if (schema->format == NULL || schema->name == NULL || schema->children == NULL) {
+        schema->n_children = 0;
+        PyErr_NoMemory();
+        return -1;
+    }
+    return 0;
+}
+
+// The array takes over the reference to owner, unless it fails in which
+// case the array is left released and the reference stays with the
+// caller.
+static int arrow_array_init(struct ArrowArray *array, const int64_t length,
+        const int64_t null_count, const int64_t n_buffers, const int64_t n_children, PyObject *owner) {
+    ArrowArrayPrivate *p = (ArrowArrayPrivate*)calloc(1, sizeof(ArrowArrayPrivate));
+    array->length = length;
+    array->null_count = null_count;
+    array->offset = 0;
+    array->n_buffers = n_buffers;
+    array->n_children = n_children;
+    array->buffers = NULL;
+    array->children = (struct ArrowArray**)calloc(n_children > 0 ? n_children : 1,
+        sizeof(struct ArrowArray*));
+    array->dictionary = NULL;
+    array->release = NULL;
+    array->private_data = NULL;
+    if (p == NULL || array->children == NULL) {
+        free(p);
+        free(array->children);
+        array->children = NULL;
+        array->n_children = 0;
+        PyErr_NoMemory();
+        return -1;
+    }
+    p->owner = owner;
+    array->buffers = p->buffers;
+    array->release = arrow_array_release;
+    array->private_data = p;
+    return 0;
+}
+
+static void arrow_column_format(const GiraffeColumn *column, const int epoch, char *format) {
+    switch (column->GDType) {
+        case GD_BYTEINT:
+            strcpy(format, "c");
+            break;
+        case GD_SMALLINT:
+            strcpy(format, "s");
+            break;
+        case GD_INTEGER:
+            strcpy(format, "i");
+            break;
+        case GD_BIGINT:
+            strcpy(format, "l");
+            break;
+        case GD_FLOAT:
+            strcpy(format, "g");
+            break;
+        case GD_DECIMAL:
+            snprintf(format, ARROW_FORMAT_SIZE, "d:%d,%d", column->Precision, column->Scale);
+            break;
+        case GD_DATE:
+            strcpy(format, "tdD");
+            break;
+        case GD_TIME:
+            strcpy(format, epoch ? "ttu" : "u");
+            break;
+        case GD_TIMESTAMP:
+            // values WITH TIME ZONE are converted to UTC
+            strcpy(format, !epoch ? "u" : column_has_time_zone(column) ? "tsu:UTC" : "tsu:");
+            break;
+        case GD_BYTE:
+            snprintf(format, ARROW_FORMAT_SIZE, "w:%llu", (unsigned long long)column->Length);
+            break;
+        case GD_VARBYTE:
+            strcpy(format, "z");
+            break;
+        default:
+            // CHAR, VARCHAR, TIME, TIMESTAMP and NUMBER are all
+            // represented as utf8 strings
+            strcpy(format, "u");
+    }
+}
+
+// Fills the array for a single column.  Most types point directly at the
+// ColumnBuffer memory, while DECIMAL (widened to 128 bits), DATE (days
+// since epoch) and CHAR (fixed stride offsets) need one extra buffer.
+// With DATETIME_AS_EPOCH, TIME and TIMESTAMP are already int64
+// microseconds and DATE is narrowed from int64 days.
+static int arrow_column_array(const GiraffeColumn *column, const int epoch, ColumnBuffer *values,
+        struct ArrowArray *array) {
+    ColumnBuffer *extra = NULL;
+    PyObject *owner;
+    unsigned char *bitmap;
+    int32_t *pos, *days, ymd;
+    int64_t *dec;
+    Py_ssize_t i, n = values->shape[0];
+    if (values->offsets != NULL) {
+        n = ((ColumnBuffer*)values->offsets)->length - 1;
+    }
+    bitmap = (unsigned char*)((ColumnBuffer*)values->validity)->data;
+    switch (column->GDType) {
+        case GD_DECIMAL:
+            if (values->itemsize == 16) {
+                break;
+            }
+            if ((extra = column_buffer_new("16s", 16, n)) == NULL) {
+                return -1;
+            }
+            dec = (int64_t*)extra->data;
+            for (i=0; i<n; i++) {
+                switch (values->itemsize) {
+                    case 1:
+                        dec[i*2] = ((int8_t*)values->data)[i];
+                        break;
+                    case 2:
+                        dec[i*2] = ((int16_t*)values->data)[i];
+                        break;
+                    case 4:
+                        dec[i*2] = ((int32_t*)values->data)[i];
+                        break;
+                    default:
+                        dec[i*2] = ((int64_t*)values->data)[i];
+                }
+                // sign extend into the high 64 bits (little-endian)
+                dec[i*2+1] = dec[i*2] < 0 ? -1 : 0;
+            }
+            break;
+        case GD_DATE:
+            if ((extra = column_buffer_new("i", 4, n)) == NULL) {
+                return -1;
+            }
+            days = (int32_t*)extra->data;
+            for (i=0; i<n; i++) {
+                if (!(bitmap[i/8] & (1 << (i % 8)))) {
+                    continue;
+                }
+                if (epoch) {
+                    days[i] = (int32_t)((int64_t*)values->data)[i];
+                    continue;
+                }
+                ymd = ((int32_t*)values->data)[i];
+                days[i] = civil_to_days(ymd / 10000, (ymd % 10000) / 100, ymd % 100);
+            }
+            break;
+        case GD_BYTEINT:
+        case GD_SMALLINT:
+        case GD_INTEGER:
+        case GD_BIGINT:
+        case GD_FLOAT:
+        case GD_BYTE:
+        case GD_VARCHAR:
+        case GD_VARBYTE:
+        case GD_NUMBER:
+            break;
+        case GD_TIME:
+        case GD_TIMESTAMP:
+            if (epoch) {
+                break;
+            }
+            // fall through
+        case GD_CHAR:
+            // LATIN1 values were transcoded to UTF-8 with their own offsets
+            if (values->offsets != NULL) {
+                break;
+            }
+            // fall through
+        default:
+            if ((extra = column_buffer_new("i", 4, n+1)) == NULL) {
+                return -1;
+            }
+            pos = (int32_t*)extra->data;
+            for (i=0; i<=n; i++) {
+                pos[i] = (int32_t)(i * values->itemsize);
+            }
+    }
+    if (extra != NULL) {
+        owner = PyTuple_Pack(2, (PyObject*)values, (PyObject*)extra);
+        Py_DECREF(extra);
+        if (owner == NULL) {
+            return -1;
+        }
+    } else {
+        Py_INCREF(values);
+        owner = (PyObject*)values;
+    }
+    if (values->offsets != NULL) {
+        if (arrow_array_init(array, n, values->null_count, 3, 0, owner) != 0) {
+            goto error;
+        }
+        array->buffers[1] = ((ColumnBuffer*)values->offsets)->data;
+        array->buffers[2] = values->data;
+    } else if (extra != NULL && column->GDType != GD_DECIMAL && column->GDType != GD_DATE) {
+        if (arrow_array_init(array, n, values->null_count, 3, 0, owner) != 0) {
+            goto error;
+        }
+        array->buffers[1] = extra->data;
+        array->buffers[2] = values->data;
+    } else {
+        if (arrow_array_init(array, n, values->null_count, 2, 0, owner) != 0) {
+            goto error;
+        }
+        array->buffers[1] = extra != NULL ? extra->data : values->data;
+    }
+    array->buffers[0] = values->null_count > 0 ? bitmap : NULL;
+    return 0;
+error:
+    Py_DECREF(owner);
+    return -1;
+}
+
+static void arrow_schema_capsule_free(PyObject *capsule) {
+    struct ArrowSchema *schema;
+    schema = (struct ArrowSchema*)PyCapsule_GetPointer(capsule, ARROW_SCHEMA_CAPSULE_NAME);
+    if (schema->release != NULL) {
+        schema->release(schema);
+    }
+    free(schema);
+}
+
+static void arrow_array_capsule_free(PyObject *capsule) {
+    struct ArrowArray *array;
+    array = (struct ArrowArray*)PyCapsule_GetPointer(capsule, ARROW_ARRAY_CAPSULE_NAME);
+    if (array->release != NULL) {
+        array->release(array);
+    }
+    free(array);
+}
+
+PyObject* teradata_buffer_to_arrow(const TeradataEncoder *e, unsigned char **data,
+        const uint32_t length) {
+    PyObject *columns, *schema_capsule, *array_capsule;
+    struct ArrowSchema *schema;
+    struct ArrowArray *array;
+    GiraffeColumn *column;
+    ColumnBuffer *values;
+    char format[ARROW_FORMAT_SIZE];
+    int64_t n = 0;
+    size_t i;
+    int epoch = (e->Settings & DATETIME_RETURN_MASK) == DATETIME_AS_EPOCH;
+    Py_RETURN_ERROR(columns = teradata_buffer_to_column_list(e, data, length));
+    if (e->Columns->length > 0) {
+        values = (ColumnBuffer*)PyList_GET_ITEM(columns, 0);
+        n = values->offsets != NULL ? ((ColumnBuffer*)values->offsets)->length - 1 : values->length;
+    }
+    // The capsules are created first so that their destructors take care
+    // of releasing partially constructed structs on error
+    schema_capsule = array_capsule = NULL;
+    if ((schema = (struct ArrowSchema*)malloc(sizeof(struct ArrowSchema))) == NULL) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    if (arrow_schema_init(schema, "+s", "", 0, e->Columns->length) != 0
+            || (schema_capsule = PyCapsule_New(schema, ARROW_SCHEMA_CAPSULE_NAME,
+                arrow_schema_capsule_free)) == NULL) {
+        schema->release(schema);
+        free(schema);
+        goto error;
+    }
+    if ((array = (struct ArrowArray*)malloc(sizeof(struct ArrowArray))) == NULL) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    if (arrow_array_init(array, n, 0, 1, e->Columns->length, NULL) != 0) {
+        free(array);
+        goto error;
+    }
+    array->buffers[0] = NULL;
+    if ((array_capsule = PyCapsule_New(array, ARROW_ARRAY_CAPSULE_NAME, arrow_array_capsule_free)) == NULL) {
+        array->release(array);
+        free(array);
+        goto error;
+    }
+    for (i=0; i<e->Columns->length; i++) {
+        column = &e->Columns->array[i];
+        values = (ColumnBuffer*)PyList_GET_ITEM(columns, i);
+        arrow_column_format(column, epoch, format);
+        if ((schema->children[i] = (struct ArrowSchema*)malloc(sizeof(struct ArrowSchema))) == NULL) {
+            PyErr_NoMemory();
+            goto error;
+        }
+        if (arrow_schema_init(schema->children[i], format, column->Title, ARROW_FLAG_NULLABLE, 0) != 0) {
+            goto error;
+        }
+        if ((array->children[i] = (struct ArrowArray*)calloc(1, sizeof(struct ArrowArray))) == NULL) {
+            PyErr_NoMemory();
+            goto error;
+        }
+        if (arrow_column_array(column, epoch, values, array->children[i]) != 0) {
+            goto error;
+        }
+    }
+    Py_DECREF(columns);
+    return Py_BuildValue("(NN)", schema_capsule, array_capsule);
+error:
+    Py_DECREF(columns);
+    Py_XDECREF(schema_capsule);
+    Py_XDECREF(array_capsule);
+    return NULL;
+}
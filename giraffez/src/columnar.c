@@ -0,0 +1,496 @@
+/*
+ * Copyright 2016 Capital One Services, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common.h"
+#include "columns.h"
+#include "convert.h"
+#include "encoder.h"
+#include "row.h"
+
+#include "columnar.h"
+
+
+ColumnBuffer* column_buffer_new(const char *format, const Py_ssize_t itemsize, const Py_ssize_t length) {
+    ColumnBuffer *b;
+    if ((b = PyObject_New(ColumnBuffer, &ColumnBufferType)) == NULL) {
+        return NULL;
+    }
+    b->length = length;
+    b->itemsize = itemsize;
+    b->size = length * itemsize;
+    b->shape[0] = length;
+    b->strides[0] = itemsize;
+    strncpy(b->format, format, COLUMN_BUFFER_FORMAT_SIZE-1);
+    b->format[COLUMN_BUFFER_FORMAT_SIZE-1] = '\0';
+    b->null_count = 0;
+    b->scale = 0;
+    b->name = NULL;
+    b->validity = NULL;
+    b->offsets = NULL;
+    // calloc is used so that slots belonging to null values are always
+    // zeroed, and at least one byte is allocated so that empty buffers
+    // still have a valid pointer to export
+    if ((b->data = (char*)calloc(b->size > 0 ? b->size : 1, sizeof(char))) == NULL) {
+        Py_DECREF(b);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    return b;
+}
+
+// Makes room for n more bytes after the current length
+static int column_buffer_reserve(ColumnBuffer *b, const Py_ssize_t n) {
+    char *data;
+    Py_ssize_t size = b->size > 0 ? b->size : 64;
+    if (b->length + n > b->size) {
+        while (b->length + n > size) {
+            size *= 2;
+        }
+        if ((data = (char*)realloc(b->data, size)) == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        b->data = data;
+        b->size = size;
+    }
+    return 0;
+}
+
+int column_buffer_write(ColumnBuffer *b, const char *src, const Py_ssize_t n) {
+    if (column_buffer_reserve(b, n) != 0) {
+        return -1;
+    }
+    memcpy(b->data + b->length, src, n);
+    b->length += n;
+    b->shape[0] = b->length;
+    return 0;
+}
+
+// Transcodes LATIN1 bytes to UTF-8, every byte above 0x7f is a code
+// point that takes two bytes.
+int column_buffer_write_latin1(ColumnBuffer *b, const unsigned char *src, const Py_ssize_t n) {
+    Py_ssize_t i;
+    char *p;
+    if (is_ascii((const char*)src, n)) {
+        return column_buffer_write(b, (const char*)src, n);
+    }
+    if (column_buffer_reserve(b, n * 2) != 0) {
+        return -1;
+    }
+    p = b->data + b->length;
+    for (i=0; i<n; i++) {
+        if (src[i] < 0x80) {
+            *p++ = (char)src[i];
+        } else {
+            *p++ = (char)(0xc0 | (src[i] >> 6));
+            *p++ = (char)(0x80 | (src[i] & 0x3f));
+        }
+    }
+    b->length = p - b->data;
+    b->shape[0] = b->length;
+    return 0;
+}
+
+int column_buffer_format(const GiraffeColumn *column, const uint32_t settings, const uint32_t charset,
+        char *format, Py_ssize_t *itemsize) {
+    // Epoch values are int64 days or microseconds, the same layout as
+    // numpy datetime64[D] and datetime64[us]
+    if ((settings & DATETIME_RETURN_MASK) == DATETIME_AS_EPOCH && (column->GDType == GD_DATE
+            || column->GDType == GD_TIME || column->GDType == GD_TIMESTAMP)) {
+        strcpy(format, "q");
+        *itemsize = 8;
+        return 0;
+    }
+    switch (column->GDType) {
+        case GD_BYTEINT:
+            strcpy(format, "b");
+            *itemsize = 1;
+            return 0;
+        case GD_SMALLINT:
+            strcpy(format, "h");
+            *itemsize = 2;
+            return 0;
+        case GD_INTEGER:
+        case GD_DATE:
+            strcpy(format, "i");
+            *itemsize = 4;
+            return 0;
+        case GD_BIGINT:
+            strcpy(format, "q");
+            *itemsize = 8;
+            return 0;
+        case GD_FLOAT:
+            strcpy(format, "d");
+            *itemsize = 8;
+            return 0;
+        case GD_DECIMAL:
+            // Decimals are stored as the unscaled integer, the scale is
+            // available as an attribute of the ColumnBuffer
+            switch (column->Length) {
+                case 1:
+                    strcpy(format, "b");
+                    *itemsize = 1;
+                    return 0;
+                case 2:
+                    strcpy(format, "h");
+                    *itemsize = 2;
+                    return 0;
+                case 4:
+                    strcpy(format, "i");
+                    *itemsize = 4;
+                    return 0;
+                case 8:
+                    strcpy(format, "q");
+                    *itemsize = 8;
+                    return 0;
+            }
+            break;
+        case GD_CHAR:
+            // LATIN1 values are transcoded to UTF-8, which no longer has
+            // a fixed width
+            if (charset != CHARSET_LATIN1) {
+                break;
+            }
+            // fall through
+        case GD_VARCHAR:
+        case GD_VARBYTE:
+        case GD_NUMBER:
+            strcpy(format, "B");
+            *itemsize = 1;
+            return 1;
+    }
+    snprintf(format, COLUMN_BUFFER_FORMAT_SIZE, "%llus", (unsigned long long)column->Length);
+    *itemsize = (Py_ssize_t)column->Length;
+    return 0;
+}
+
+PyObject* teradata_buffer_to_column_list(const TeradataEncoder *e, unsigned char **data,
+        const uint32_t length) {
+    PyObject *result;
+    ColumnBuffer **values, **validity, **offsets;
+    GiraffeColumn *column;
+    Py_ssize_t itemsize;
+    unsigned char *start, *bitmap;
+    char format[COLUMN_BUFFER_FORMAT_SIZE];
+    char item[BUFFER_ITEM_SIZE];
+    uint32_t n, r;
+    uint16_t row_length, H;
+    int32_t *pos = NULL, d;
+    int64_t us;
+    size_t i;
+    int variable, len, nulls, epoch;
+    n = teradata_buffer_count_rows(*data, length);
+    epoch = (e->Settings & DATETIME_RETURN_MASK) == DATETIME_AS_EPOCH;
+    // The result list holds the only reference to each ColumnBuffer so
+    // any error only needs to release the list
+    result = NULL;
+    values = (ColumnBuffer**)calloc(e->Columns->length, sizeof(ColumnBuffer*));
+    validity = (ColumnBuffer**)calloc(e->Columns->length, sizeof(ColumnBuffer*));
+    offsets = (ColumnBuffer**)calloc(e->Columns->length, sizeof(ColumnBuffer*));
+    if (values == NULL || validity == NULL || offsets == NULL) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    if ((result = PyList_New(e->Columns->length)) == NULL) {
+        goto error;
+    }
+    for (i=0; i<e->Columns->length; i++) {
+        column = &e->Columns->array[i];
+        variable = column_buffer_format(column, e->Settings, e->Charset, format, &itemsize);
+        if ((values[i] = column_buffer_new(format, itemsize, variable ? 0 : n)) == NULL) {
+            goto error;
+        }
+        PyList_SET_ITEM(result, i, (PyObject*)values[i]);
+        if ((validity[i] = column_buffer_new("B", 1, (n+7)/8)) == NULL) {
+            goto error;
+        }
+        values[i]->validity = (PyObject*)validity[i];
+        if ((values[i]->name = PyUnicode_FromString(column->Title)) == NULL) {
+            goto error;
+        }
+        values[i]->scale = column->Scale;
+        if (variable) {
+            if ((offsets[i] = column_buffer_new("i", 4, n+1)) == NULL) {
+                goto error;
+            }
+            values[i]->offsets = (PyObject*)offsets[i];
+        }
+    }
+    for (r=0; r<n; r++) {
+        unpack_uint16_t(data, &row_length);
+        start = *data;
+        nulls = indicator_set(e->Columns, data);
+        for (i=0; i<e->Columns->length; i++) {
+            column = &e->Columns->array[i];
+            if (offsets[i] != NULL) {
+                pos = (int32_t*)offsets[i]->data;
+                pos[r+1] = pos[r];
+            }
+            if (nulls && indicator_read(e->Columns->buffer, i)) {
+                *data += column->NullLength;
+                values[i]->null_count++;
+                continue;
+            }
+            bitmap = (unsigned char*)validity[i]->data;
+            bitmap[r/8] |= (1 << (r % 8));
+            switch (column->GDType) {
+                case GD_BYTEINT:
+                    unpack_int8_t(data, &((int8_t*)values[i]->data)[r]);
+                    break;
+                case GD_SMALLINT:
+                    unpack_int16_t(data, &((int16_t*)values[i]->data)[r]);
+                    break;
+                case GD_INTEGER:
+                    unpack_int32_t(data, &((int32_t*)values[i]->data)[r]);
+                    break;
+                case GD_BIGINT:
+                    unpack_int64_t(data, &((int64_t*)values[i]->data)[r]);
+                    break;
+                case GD_FLOAT:
+                    unpack_float(data, &((double*)values[i]->data)[r]);
+                    break;
+                case GD_DATE:
+                    // Teradata stores dates as (YYYYMMDD - 19000000)
+                    unpack_int32_t(data, &d);
+                    if (epoch) {
+                        ((int64_t*)values[i]->data)[r] = teradata_dateint_to_days(d);
+                    } else {
+                        ((int32_t*)values[i]->data)[r] = d + 19000000;
+                    }
+                    break;
+                case GD_TIME:
+                case GD_TIMESTAMP:
+                    if (!epoch) {
+                        memcpy(values[i]->data + r*values[i]->itemsize, *data, column->Length);
+                    } else if ((column->GDType == GD_TIME
+                            ? teradata_time_to_epoch_us(*data, column->Length, &us)
+                            : teradata_ts_to_epoch_us(*data, column->Length, &us)) == 0) {
+                        ((int64_t*)values[i]->data)[r] = us;
+                    } else {
+                        PyErr_Format(EncoderError, "Unable to convert '%.*s' to an epoch value",
+                            (int)column->Length, *data);
+                        goto error;
+                    }
+                    *data += column->Length;
+                    break;
+                case GD_DECIMAL:
+                    switch (column->Length) {
+                        case DECIMAL8:
+                            unpack_int8_t(data, &((int8_t*)values[i]->data)[r]);
+                            break;
+                        case DECIMAL16:
+                            unpack_int16_t(data, &((int16_t*)values[i]->data)[r]);
+                            break;
+                        case DECIMAL32:
+                            unpack_int32_t(data, &((int32_t*)values[i]->data)[r]);
+                            break;
+                        case DECIMAL64:
+                            unpack_int64_t(data, &((int64_t*)values[i]->data)[r]);
+                            break;
+                        default:
+                            memcpy(values[i]->data + r*values[i]->itemsize, *data, column->Length);
+                            *data += column->Length;
+                    }
+                    break;
+                case GD_CHAR:
+                    if (offsets[i] == NULL) {
+                        memcpy(values[i]->data + r*values[i]->itemsize, *data, column->Length);
+                    } else if (column_buffer_write_latin1(values[i], *data, column->Length) != 0) {
+                        goto error;
+                    } else {
+                        pos[r+1] = (int32_t)values[i]->length;
+                    }
+                    *data += column->Length;
+                    break;
+                case GD_VARCHAR:
+                    unpack_uint16_t(data, &H);
+                    if ((e->Charset == CHARSET_LATIN1
+                            ? column_buffer_write_latin1(values[i], *data, H)
+                            : column_buffer_write(values[i], (char*)*data, H)) != 0) {
+                        goto error;
+                    }
+                    *data += H;
+                    pos[r+1] = (int32_t)values[i]->length;
+                    break;
+                case GD_VARBYTE:
+                    unpack_uint16_t(data, &H);
+                    if (column_buffer_write(values[i], (char*)*data, H) != 0) {
+                        goto error;
+                    }
+                    *data += H;
+                    pos[r+1] = (int32_t)values[i]->length;
+                    break;
+                case GD_NUMBER:
+                    if ((len = teradata_number_to_cstring(data, item)) < 0) {
+                        goto error;
+                    }
+                    if (column_buffer_write(values[i], item, len) != 0) {
+                        goto error;
+                    }
+                    pos[r+1] = (int32_t)values[i]->length;
+                    break;
+                default:
+                    memcpy(values[i]->data + r*values[i]->itemsize, *data, column->Length);
+                    *data += column->Length;
+            }
+        }
+        *data = start + row_length;
+    }
+    free(values);
+    free(validity);
+    free(offsets);
+    return result;
+error:
+    Py_XDECREF(result);
+    free(values);
+    free(validity);
+    free(offsets);
+    return NULL;
+}
+
+PyObject* teradata_buffer_to_columnar(const TeradataEncoder *e, unsigned char **data,
+        const uint32_t length) {
+    PyObject *columns, *result;
+    size_t i;
+    Py_RETURN_ERROR(columns = teradata_buffer_to_column_list(e, data, length));
+    if ((result = PyDict_New()) == NULL) {
+        Py_DECREF(columns);
+        return NULL;
+    }
+    // Unlike dict rows, where a later column silently replaces an earlier
+    // one with the same title, a whole column would be lost here
+    for (i=0; i<e->Columns->length; i++) {
+        if (PyDict_GetItemString(result, e->Columns->array[i].Title) != NULL) {
+            PyErr_Format(EncoderError, "Columnar output requires unique column titles, '%s' is repeated",
+                e->Columns->array[i].Title);
+            goto error;
+        }
+        if (PyDict_SetItemString(result, e->Columns->array[i].Title, PyList_GET_ITEM(columns, i)) == -1) {
+            goto error;
+        }
+    }
+    Py_DECREF(columns);
+    return result;
+error:
+    Py_DECREF(columns);
+    Py_DECREF(result);
+    return NULL;
+}
+
+static void ColumnBuffer_dealloc(ColumnBuffer *self) {
+    free(self->data);
+    self->data = NULL;
+    Py_XDECREF(self->name);
+    Py_XDECREF(self->validity);
+    Py_XDECREF(self->offsets);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int ColumnBuffer_getbuffer(ColumnBuffer *self, Py_buffer *view, int flags) {
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "ColumnBuffer is read-only");
+        return -1;
+    }
+    view->obj = (PyObject*)self;
+    Py_INCREF(self);
+    view->buf = self->data;
+    view->len = self->shape[0] * self->itemsize;
+    view->readonly = 1;
+    view->itemsize = self->itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? self->format : NULL;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? self->shape : NULL;
+    view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? self->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+
+static Py_ssize_t ColumnBuffer_length(ColumnBuffer *self) {
+    // Variable-length columns report the number of values rather than
+    // the number of bytes stored
+    if (self->offsets != NULL) {
+        return ((ColumnBuffer*)self->offsets)->length - 1;
+    }
+    return self->length;
+}
+
+static PyBufferProcs ColumnBuffer_as_buffer = {
+#if PY_MAJOR_VERSION < 3
+    0,                                              /* bf_getreadbuffer */
+    0,                                              /* bf_getwritebuffer */
+    0,                                              /* bf_getsegcount */
+    0,                                              /* bf_getcharbuffer */
+#endif
+    (getbufferproc)ColumnBuffer_getbuffer,          /* bf_getbuffer */
+    0,                                              /* bf_releasebuffer */
+};
+
+static PySequenceMethods ColumnBuffer_as_sequence = {
+    (lenfunc)ColumnBuffer_length,                   /* sq_length */
+};
+
+static PyMemberDef ColumnBuffer_members[] = {
+    {"name", T_OBJECT, offsetof(ColumnBuffer, name), READONLY, ""},
+    {"format", T_STRING_INPLACE, offsetof(ColumnBuffer, format), READONLY, ""},
+    {"itemsize", T_PYSSIZET, offsetof(ColumnBuffer, itemsize), READONLY, ""},
+    {"null_count", T_INT, offsetof(ColumnBuffer, null_count), READONLY, ""},
+    {"scale", T_INT, offsetof(ColumnBuffer, scale), READONLY, ""},
+    {"validity", T_OBJECT, offsetof(ColumnBuffer, validity), READONLY, ""},
+    {"offsets", T_OBJECT, offsetof(ColumnBuffer, offsets), READONLY, ""},
+    {NULL}  /* Sentinel */
+};
+
+PyTypeObject ColumnBufferType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_teradata.ColumnBuffer",                       /* tp_name */
+    sizeof(ColumnBuffer),                           /* tp_basicsize */
+    0,                                              /* tp_itemsize */
+    (destructor)ColumnBuffer_dealloc,               /* tp_dealloc */
+    0,                                              /* tp_print */
+    0,                                              /* tp_getattr */
+    0,                                              /* tp_setattr */
+    0,                                              /* tp_compare */
+    0,                                              /* tp_repr */
+    0,                                              /* tp_as_number */
+    &ColumnBuffer_as_sequence,                      /* tp_as_sequence */
+    0,                                              /* tp_as_mapping */
+    0,                                              /* tp_hash */
+    0,                                              /* tp_call */
+    0,                                              /* tp_str */
+    0,                                              /* tp_getattro */
+    0,                                              /* tp_setattro */
+    &ColumnBuffer_as_buffer,                        /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER, /* tp_flags */
+    "ColumnBuffer objects",                         /* tp_doc */
+    0,                                              /* tp_traverse */
+    0,                                              /* tp_clear */
+    0,                                              /* tp_richcompare */
+    0,                                              /* tp_weaklistoffset */
+    0,                                              /* tp_iter */
+    0,                                              /* tp_iternext */
+    0,                                              /* tp_methods */
+    ColumnBuffer_members,                           /* tp_members */
+    0,                                              /* tp_getset */
+    0,                                              /* tp_base */
+    0,                                              /* tp_dict */
+    0,                                              /* tp_descr_get */
+    0,                                              /* tp_descr_set */
+    0,                                              /* tp_dictoffset */
+    0,                                              /* tp_init */
+    0,                                              /* tp_alloc */
+    0,                                              /* tp_new */
+};
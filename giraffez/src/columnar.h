@@ -0,0 +1,71 @@
+/*
+ * Copyright 2016 Capital One Services, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GIRAFFEZ_COLUMNAR_H
+#define __GIRAFFEZ_COLUMNAR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+#include "columns.h"
+#include "encoder.h"
+
+
+#define COLUMN_BUFFER_FORMAT_SIZE 16
+
+// ColumnBuffer is a contiguous, typed array of values for a single
+// column that is exposed to Python through the buffer protocol.  For
+// fixed-width types each item is one value, while variable-length
+// types (VARCHAR, VARBYTE, NUMBER) store the concatenated bytes and
+// keep the boundaries of each value in a separate int32 offsets
+// buffer (n+1 items, Arrow-style).  Strings are always UTF-8, so with
+// a LATIN1 session CHAR values are transcoded and become variable-length
+// as well.
+typedef struct {
+    PyObject_HEAD
+    char       *data;
+    Py_ssize_t length;
+    Py_ssize_t itemsize;
+    Py_ssize_t size;
+    Py_ssize_t shape[1];
+    Py_ssize_t strides[1];
+    char       format[COLUMN_BUFFER_FORMAT_SIZE];
+    int        null_count;
+    int        scale;
+    PyObject   *name;
+    PyObject   *validity;
+    PyObject   *offsets;
+} ColumnBuffer;
+
+ColumnBuffer* column_buffer_new(const char *format, const Py_ssize_t itemsize, const Py_ssize_t length);
+int           column_buffer_write(ColumnBuffer *b, const char *src, const Py_ssize_t n);
+int           column_buffer_write_latin1(ColumnBuffer *b, const unsigned char *src, const Py_ssize_t n);
+
+int column_buffer_format(const GiraffeColumn *column, const uint32_t settings, const uint32_t charset,
+    char *format, Py_ssize_t *itemsize);
+
+PyObject* teradata_buffer_to_column_list(const TeradataEncoder *e, unsigned char **data,
+    const uint32_t length);
+PyObject* teradata_buffer_to_columnar(const TeradataEncoder *e, unsigned char **data,
+    const uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -130,7 +130,7 @@ void           columns_init(GiraffeColumns *c, size_t initial_size);
 void           columns_append(GiraffeColumns *c, GiraffeColumn element);
 void           columns_free(GiraffeColumns *c);
 
-void indicator_set(GiraffeColumns *columns, unsigned char **data);
+int  indicator_set(GiraffeColumns *columns, unsigned char **data);
 void indicator_clear(unsigned char **ind, size_t n);
 int  indicator_read(unsigned char *ind, size_t pos);
 void indicator_write(unsigned char **ind, size_t pos, int value);
@@ -143,6 +143,7 @@ void                 stmt_info_free(StatementInfo *s);
 char*           safe_name(const char *name);
 int             compare_name(const char *l, const char *r);
 uint64_t        format_length(const char *format);
+int             column_has_time_zone(const GiraffeColumn *column);
 GiraffeColumns* columns_from_stmtinfo(unsigned char **data, const uint32_t length);
 
 #ifdef __cplusplus
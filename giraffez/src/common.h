@@ -27,6 +27,7 @@ extern "C" {
 #include <Python.h>
 #include <structmember.h>
 #include <ctype.h>
+#include <float.h>
 #include <math.h>
 #include <stddef.h>
 #if defined(WIN32) || defined(WIN64)
@@ -46,8 +47,14 @@ extern const char *strptime(const char *buf, const char *fmt, struct tm *tm);
 // Python 2/3 C API and Windows compatibility
 #include "_compat.h"
 
+// SSE2 is part of the x86-64 baseline, so it is used wherever it is
+// available without requiring additional compiler flags
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GIRAFFEZ_SSE2
+#include <emmintrin.h>
+#endif
+
 // General compile-time settings
-#define BUFFER_STRPTIME_SIZE 1024
 #define BUFFER_ITEM_SIZE     1024
 #define BUFFER_FORMAT_SIZE   1024
 
@@ -56,6 +63,14 @@ extern const char *strptime(const char *buf, const char *fmt, struct tm *tm);
 #define MAX_PARCEL_ATTEMPTS  5
 #define TERADATA_CHARSET     "UTF8"
 
+// Session character sets understood by the encoder.  The session charset
+// is TERADATA_CHARSET unless a connection asks for another one, and
+// determines how CHAR/VARCHAR bytes are turned into Python strings.
+enum CharsetType {
+    CHARSET_UTF8   = 0,
+    CHARSET_LATIN1 = 1,
+};
+
 // CLIv2 attempts to define a type error_t which already exists in the standard library
 #define NO_CLIV2_ERROR_T
 // Required to compile with C++ compilers
@@ -74,9 +89,12 @@ PyObject* define_exceptions(PyObject *module);
 
 
 extern PyTypeObject CmdType;
+extern PyTypeObject ColumnBufferType;
 extern PyTypeObject EncoderType;
 extern PyTypeObject ExportType;
 extern PyTypeObject MLoadType;
+extern PyTypeObject LazyRecordType;
+extern PyTypeObject RecordType;
 
 extern PyObject *TeradataError;
 extern PyObject *GiraffezError;
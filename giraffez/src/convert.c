@@ -16,6 +16,9 @@
 
 #include "common.h"
 #include "columns.h"
+#include "grisu.h"
+
+#include <datetime.h>
 
 #include "convert.h"
 
@@ -192,23 +195,175 @@ uint16_t unpack_string(unsigned char **data, char **str) {
 }
 
 // Character types
+// Returns nonzero when none of the bytes have the high bit set.  Most
+// string data is pure ASCII, in which case the decoding can be skipped
+// entirely.
+int is_ascii(const char *s, const size_t n) {
+    const unsigned char *p = (const unsigned char*)s;
+    uint64_t w;
+    size_t i = 0;
+#ifdef GIRAFFEZ_SSE2
+    for (; i + 16 <= n; i += 16) {
+        if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(p+i))) != 0) {
+            return 0;
+        }
+    }
+#endif
+    for (; i + 8 <= n; i += 8) {
+        memcpy(&w, p+i, 8);
+        if (w & 0x8080808080808080ULL) {
+            return 0;
+        }
+    }
+    for (; i < n; i++) {
+        if (p[i] & 0x80) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Returns the length of s without its trailing spaces (the pad byte of
+// CHAR columns), scanning backwards a vector or word at a time.  Padding
+// usually makes up most of the value, so whole blocks of spaces are
+// skipped (64 bytes per test while they last) before the last few bytes
+// are checked one at a time.
+size_t rtrim_length(const char *s, size_t n) {
+    const unsigned char *p = (const unsigned char*)s;
+    uint64_t w;
+#ifdef GIRAFFEZ_SSE2
+    const __m128i spaces = _mm_set1_epi8(' ');
+    __m128i a, b;
+    while (n >= 64) {
+        a = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p+n-16)), spaces),
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p+n-32)), spaces));
+        b = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p+n-48)), spaces),
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p+n-64)), spaces));
+        if (_mm_movemask_epi8(_mm_and_si128(a, b)) != 0xffff) {
+            break;
+        }
+        n -= 64;
+    }
+    while (n >= 16 && _mm_movemask_epi8(_mm_cmpeq_epi8(
+            _mm_loadu_si128((const __m128i*)(p+n-16)), spaces)) == 0xffff) {
+        n -= 16;
+    }
+#endif
+    while (n >= 8) {
+        memcpy(&w, p+n-8, 8);
+        if (w != 0x2020202020202020ULL) {
+            break;
+        }
+        n -= 8;
+    }
+    while (n > 0 && p[n-1] == ' ') {
+        n--;
+    }
+    return n;
+}
+
+// Builds a compact ASCII string by copying the bytes directly, the caller
+// must have checked the input with is_ascii.
+static PyObject* ascii_to_pystring(const char *s, const Py_ssize_t n) {
+#if PY_MAJOR_VERSION >= 3
+    PyObject *str;
+    if ((str = PyUnicode_New(n, 127)) == NULL) {
+        return NULL;
+    }
+    memcpy(PyUnicode_1BYTE_DATA(str), s, n);
+    return str;
+#else
+    return PyUnicode_FromStringAndSize(s, n);
+#endif
+}
+
+PyObject* utf8_to_pystring(const char *s, const Py_ssize_t n) {
+    if (is_ascii(s, n)) {
+        return ascii_to_pystring(s, n);
+    }
+    return PyUnicode_DecodeUTF8(s, n, NULL);
+}
+
+// Every byte is a code point in LATIN1, the only work left for non-ASCII
+// strings is widening them to the 1-byte latin1 kind.
+PyObject* latin1_to_pystring(const char *s, const Py_ssize_t n) {
+    if (is_ascii(s, n)) {
+        return ascii_to_pystring(s, n);
+    }
+    return PyUnicode_DecodeLatin1(s, n, NULL);
+}
+
 PyObject* teradata_char_to_pystring(unsigned char **data, const uint64_t column_length) {
-    PyObject *str = PyUnicode_FromStringAndSize((char*)*data, column_length);
+    PyObject *str = utf8_to_pystring((char*)*data, column_length);
     *data += column_length;
     return str;
 }
 
+// The column length of CHAR columns in a UTF8 session is in bytes, which
+// is up to 3 times the number of characters in the FORMAT, so the string
+// is truncated to the format length after decoding.  When the bytes
+// within the format length are ASCII they are the characters of the
+// value, and the rest of the column does not need to be looked at.
 PyObject* teradata_char_to_pystring_f(unsigned char **data, const uint64_t column_length, const uint64_t format_length) {
-    PyObject *str = teradata_char_to_pystring(data, column_length);
+    const char *s = (char*)*data;
+    uint64_t n = (format_length > 0 && format_length <= column_length) ? format_length : column_length;
+    PyObject *str;
+    *data += column_length;
+    if (is_ascii(s, n)) {
+        return ascii_to_pystring(s, n);
+    }
+    if ((str = PyUnicode_DecodeUTF8(s, column_length, NULL)) == NULL) {
+        return NULL;
+    }
     if (format_length > 0 && format_length <= column_length) {
-        PyObject *slice = PySlice_New(PyLong_FromLong(0),
-                PyLong_FromUnsignedLongLong(format_length), PyLong_FromLong(1));
-        Py_SETREF(str, PyObject_GetItem(str, slice));
-        Py_DECREF(slice);
+        Py_SETREF(str, PySequence_GetSlice(str, 0, format_length));
     }
     return str;
 }
 
+PyObject* teradata_char_to_pystring_latin1(unsigned char **data, const uint64_t column_length, const uint64_t format_length) {
+    PyObject *str = latin1_to_pystring((char*)*data, (format_length > 0 && format_length <= column_length) ?
+        format_length : column_length);
+    *data += column_length;
+    return str;
+}
+
+// With STRING_TRIM_CHAR the padding is removed from the bytes before the
+// string is created.  The format length still applies to values that do
+// not fit in it, which are trimmed again after being truncated.
+PyObject* teradata_char_to_pystring_trim(unsigned char **data, const uint64_t column_length,
+        const uint64_t format_length) {
+    const char *s = (char*)*data;
+    size_t n = rtrim_length(s, column_length);
+    *data += column_length;
+    if (is_ascii(s, n)) {
+        if (format_length > 0 && format_length < n) {
+            n = rtrim_length(s, format_length);
+        }
+        return ascii_to_pystring(s, n);
+    }
+    if (format_length > 0) {
+        // byte offset of the first character past the format length,
+        // continuation bytes (10xxxxxx) do not start a character
+        size_t i, chars = 0;
+        for (i=0; i<n; i++) {
+            if (((unsigned char)s[i] & 0xc0) != 0x80 && chars++ == format_length) {
+                n = rtrim_length(s, i);
+                break;
+            }
+        }
+    }
+    return PyUnicode_DecodeUTF8(s, n, NULL);
+}
+
+PyObject* teradata_char_to_pystring_latin1_trim(unsigned char **data, const uint64_t column_length,
+        const uint64_t format_length) {
+    PyObject *str = latin1_to_pystring((char*)*data, rtrim_length((char*)*data,
+        (format_length > 0 && format_length <= column_length) ? format_length : column_length));
+    *data += column_length;
+    return str;
+}
+
 PyObject* teradata_byte_to_pybytes(unsigned char **data, const uint64_t column_length) {
     PyObject *str = PyBytes_FromStringAndSize((char*)*data, column_length);
     *data += column_length;
@@ -219,7 +374,16 @@ PyObject* teradata_varchar_to_pystring(unsigned char **data) {
     PyObject *str;
     uint16_t H;
     unpack_uint16_t(data, &H);
-    str = PyUnicode_FromStringAndSize((char*)*data, H);
+    str = utf8_to_pystring((char*)*data, H);
+    *data += H;
+    return str;
+}
+
+PyObject* teradata_varchar_to_pystring_latin1(unsigned char **data) {
+    PyObject *str;
+    uint16_t H;
+    unpack_uint16_t(data, &H);
+    str = latin1_to_pystring((char*)*data, H);
     *data += H;
     return str;
 }
@@ -234,6 +398,156 @@ PyObject* teradata_varbyte_to_pybytes(unsigned char **data) {
 }
 
 // Numeric types
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const uint64_t pow10_u64[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+// Writes the decimal digits of v two at a time backwards from end and
+// returns the number of digits written.
+static int uint64_digits(uint64_t v, char *end) {
+    char *p = end;
+    while (v >= 100) {
+        p -= 2;
+        memcpy(p, &digit_pairs[(v % 100) * 2], 2);
+        v /= 100;
+    }
+    if (v >= 10) {
+        p -= 2;
+        memcpy(p, &digit_pairs[v * 2], 2);
+    } else {
+        *--p = (char)('0' + v);
+    }
+    return (int)(end - p);
+}
+
+// Same as uint64_digits, but always writes width digits (zero padded)
+static void uint64_digits_fixed(uint64_t v, int width, char *end) {
+    int n = uint64_digits(v, end);
+    memset(end - width, '0', width - n);
+}
+
+// Writes the digits of the unsigned 128-bit value hi:lo backwards from
+// end, returning the number of digits written (at most 39).  The value
+// is split into chunks of 18 digits (9 without __int128) so that the
+// digits of each chunk can be produced with 64-bit arithmetic.
+static int uint128_digits(uint64_t hi, uint64_t lo, char *end) {
+    char *p = end;
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 v = ((unsigned __int128)hi << 64) | lo;
+    while (v >> 64) {
+        uint64_digits_fixed((uint64_t)(v % pow10_u64[18]), 18, p);
+        v /= pow10_u64[18];
+        p -= 18;
+    }
+    lo = (uint64_t)v;
+#else
+    uint32_t limbs[4];
+    uint64_t r;
+    int i;
+    limbs[0] = (uint32_t)(hi >> 32);
+    limbs[1] = (uint32_t)hi;
+    limbs[2] = (uint32_t)(lo >> 32);
+    limbs[3] = (uint32_t)lo;
+    while (limbs[0] || limbs[1]) {
+        r = 0;
+        for (i=0; i<4; i++) {
+            r = (r << 32) | limbs[i];
+            limbs[i] = (uint32_t)(r / pow10_u64[9]);
+            r %= pow10_u64[9];
+        }
+        uint64_digits_fixed(r, 9, p);
+        p -= 9;
+    }
+    lo = ((uint64_t)limbs[2] << 32) | limbs[3];
+#endif
+    if (p == end || lo != 0) {
+        p -= uint64_digits(lo, p);
+    }
+    return (int)(end - p);
+}
+
+// Writes a scaled integer as a decimal string given its digits (most
+// significant first), placing the sign and decimal point in a single
+// pass.  A negative scale appends zeros (only used by NUMBER).
+static int decimal_digits_to_cstring(const char *digits, int n, int negative, int scale, char *buf) {
+    char *p = buf;
+    if (negative) {
+        *p++ = '-';
+    }
+    if (scale <= 0) {
+        memcpy(p, digits, n);
+        p += n;
+        memset(p, '0', -scale);
+        p += -scale;
+    } else if (n > scale) {
+        memcpy(p, digits, n - scale);
+        p += n - scale;
+        *p++ = '.';
+        memcpy(p, digits + n - scale, scale);
+        p += scale;
+    } else {
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', scale - n);
+        p += scale - n;
+        memcpy(p, digits, n);
+        p += n;
+    }
+    *p = '\0';
+    return (int)(p - buf);
+}
+
+static int int64_decimal_to_cstring(int64_t v, int scale, char *buf) {
+    char digits[24];
+    char *end = digits + sizeof(digits);
+    int n = uint64_digits(v < 0 ? 0 - (uint64_t)v : (uint64_t)v, end);
+    return decimal_digits_to_cstring(end - n, n, v < 0, scale, buf);
+}
+
+static int int128_decimal_to_cstring(uint64_t hi, uint64_t lo, int scale, char *buf) {
+    char digits[48];
+    char *end = digits + sizeof(digits);
+    int negative = (int)(hi >> 63), n;
+    if (negative) {
+        lo = ~lo + 1;
+        hi = ~hi + (lo == 0);
+    }
+    n = uint128_digits(hi, lo, end);
+    return decimal_digits_to_cstring(end - n, n, negative, scale, buf);
+}
+
+// Writes the decimal digits of v, returning the number of characters
+// written to buf (which is not NUL terminated).
+int uint64_to_cstring(uint64_t v, char *buf) {
+    char tmp[20];
+    int n = uint64_digits(v, tmp + sizeof(tmp));
+    memcpy(buf, tmp + sizeof(tmp) - n, n);
+    return n;
+}
+
+int int64_to_cstring(int64_t v, char *buf) {
+    if (v < 0) {
+        *buf = '-';
+        return uint64_to_cstring(0 - (uint64_t)v, buf+1) + 1;
+    }
+    return uint64_to_cstring((uint64_t)v, buf);
+}
+
 PyObject* teradata_byteint_to_pylong(unsigned char **data) {
     int8_t b;
     unpack_int8_t(data, &b);
@@ -242,8 +556,9 @@ PyObject* teradata_byteint_to_pylong(unsigned char **data) {
 
 PyObject* teradata_byteint_to_pystring(unsigned char **data) {
     int8_t b;
+    char buf[24];
     unpack_int8_t(data, &b);
-    return PyUnicode_FromFormat("%d", b);
+    return ascii_to_pystring(buf, int64_to_cstring(b, buf));
 }
 
 PyObject* teradata_smallint_to_pylong(unsigned char **data) {
@@ -254,8 +569,9 @@ PyObject* teradata_smallint_to_pylong(unsigned char **data) {
 
 PyObject* teradata_smallint_to_pystring(unsigned char **data) {
     int16_t h;
+    char buf[24];
     unpack_int16_t(data, &h);
-    return PyUnicode_FromFormat("%d", h);
+    return ascii_to_pystring(buf, int64_to_cstring(h, buf));
 }
 
 PyObject* teradata_int_to_pylong(unsigned char **data) {
@@ -266,8 +582,9 @@ PyObject* teradata_int_to_pylong(unsigned char **data) {
 
 PyObject* teradata_int_to_pystring(unsigned char **data) {
     int32_t l;
+    char buf[24];
     unpack_int32_t(data, &l);
-    return PyUnicode_FromFormat("%d", l);
+    return ascii_to_pystring(buf, int64_to_cstring(l, buf));
 }
 
 PyObject* teradata_bigint_to_pylong(unsigned char **data) {
@@ -278,8 +595,9 @@ PyObject* teradata_bigint_to_pylong(unsigned char **data) {
 
 PyObject* teradata_bigint_to_pystring(unsigned char **data) {
     int64_t q;
+    char buf[24];
     unpack_int64_t(data, &q);
-    return pystring_from_cformat("%lld", q);
+    return ascii_to_pystring(buf, int64_to_cstring(q, buf));
 }
 
 PyObject* teradata_float_to_pyfloat(unsigned char **data) {
@@ -289,15 +607,40 @@ PyObject* teradata_float_to_pyfloat(unsigned char **data) {
 }
 
 PyObject* teradata_float_to_pystring(unsigned char **data) {
-    PyObject *obj;
-    PyObject *s;
-    obj = teradata_float_to_pyfloat(data);
-    s = PyObject_Str(obj);
-    Py_DECREF(obj);
-    return s;
+    double d;
+    char buf[32];
+    int n;
+    unpack_float(data, &d);
+    n = double_to_cstring(d, buf);
+    // Keep the Python str() form for integral values (i.e. 1.0 not 1)
+    if (memchr(buf, '.', n) == NULL && memchr(buf, 'e', n) == NULL && isdigit(buf[n-1])) {
+        memcpy(buf+n, ".0", 2);
+        n += 2;
+    }
+    return ascii_to_pystring(buf, n);
 }
 
 // Dates
+// Writes YYYY-MM-DD directly, only years outside of 0-9999 (which are
+// not valid Teradata dates) go through snprintf.
+int date_to_cstring(int32_t year, int32_t month, int32_t day, char *buf) {
+    int n;
+    if (year < 0 || year > 9999 || month < 0 || month > 99 || day < 0 || day > 99) {
+        // snprintf returns the length the date would have had, only the
+        // first 10 characters are written
+        n = snprintf(buf, 11, "%04d-%02d-%02d", year, month, day);
+        return n < 0 ? 0 : n > 10 ? 10 : n;
+    }
+    memcpy(buf, &digit_pairs[(year / 100) * 2], 2);
+    memcpy(buf+2, &digit_pairs[(year % 100) * 2], 2);
+    buf[4] = '-';
+    memcpy(buf+5, &digit_pairs[month * 2], 2);
+    buf[7] = '-';
+    memcpy(buf+8, &digit_pairs[day * 2], 2);
+    buf[10] = '\0';
+    return 10;
+}
+
 int teradata_date_to_cstring(unsigned char **data, char *buf) {
     int32_t l, year, month, day;
     unpack_int32_t(data, &l);
@@ -305,56 +648,237 @@ int teradata_date_to_cstring(unsigned char **data, char *buf) {
     year = l / 10000;
     month = (l % 10000) / 100;
     day = l % 100;
-    return snprintf(buf, 11, "%04d-%02d-%02d", year, month, day);
+    return date_to_cstring(year, month, day, buf);
 }
 
 PyObject* teradata_date_to_giraffez_date(unsigned char **data) {
-    int32_t l, year, month, day;
+    int32_t l;
     unpack_int32_t(data, &l);
-    l += 19000000;
-    year = l / 10000;
-    month = (l % 10000) / 100;
-    day = l % 100;
-    return giraffez_date_from_datetime(year, month, day, 0, 0, 0, 0);
+    return teradata_dateint_to_giraffez_date(l);
+}
+
+PyObject* teradata_date_to_pydate(unsigned char **data) {
+    int32_t l;
+    unpack_int32_t(data, &l);
+    return teradata_dateint_to_pydate(l);
 }
 
 PyObject* teradata_date_to_pystring(unsigned char **data) {
-    int32_t l, year, month, day;
-    char s[11];
+    int32_t l;
     unpack_int32_t(data, &l);
+    return teradata_dateint_to_pystring(l);
+}
+
+// Conversions from the raw DATE value (YYYYMMDD - 19000000), used by the
+// date cache in plan.c
+PyObject* teradata_dateint_to_giraffez_date(int32_t l) {
     l += 19000000;
-    year = l / 10000;
-    month = (l % 10000) / 100;
-    day = l % 100;
-    sprintf(s, "%04d-%02d-%02d", year, month, day);
-    return PyUnicode_FromStringAndSize(s, 10);
+    return giraffez_date_from_datetime(l / 10000, (l % 10000) / 100, l % 100, 0, 0, 0, 0);
+}
+
+PyObject* teradata_dateint_to_pydate(int32_t l) {
+    l += 19000000;
+    return PyDate_FromDate(l / 10000, (l % 10000) / 100, l % 100);
+}
+
+PyObject* teradata_dateint_to_pystring(int32_t l) {
+    char s[11];
+    int n;
+    l += 19000000;
+    n = date_to_cstring(l / 10000, (l % 10000) / 100, l % 100, s);
+    return ascii_to_pystring(s, n);
+}
+
+// Number of days since 1970-01-01 for a proleptic Gregorian date, see
+// http://howardhinnant.github.io/date_algorithms.html#days_from_civil
+int32_t civil_to_days(int32_t year, int32_t month, int32_t day) {
+    int32_t era, yoe, doy, doe;
+    year -= month <= 2;
+    era = (year >= 0 ? year : year-399) / 400;
+    yoe = year - era * 400;
+    doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    doe = yoe * 365 + yoe/4 - yoe/100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// Reads n ASCII digits, returning -1 if any of them is not a digit
+static inline int parse_digits(const unsigned char *s, const int n) {
+    int i, v = 0;
+    for (i=0; i<n; i++) {
+        if (s[i] < '0' || s[i] > '9') {
+            return -1;
+        }
+        v = v * 10 + (s[i] - '0');
+    }
+    return v;
+}
+
+// Parses the Teradata time layout HH:MI:SS[.ffffff] directly from the
+// row, any time zone following it is ignored.  Returns -1 when the value
+// does not have this layout or is out of range.
+static int parse_time(const unsigned char *s, const uint64_t length, int *hour, int *minute,
+        int *second, int *microsecond) {
+    uint64_t i;
+    int n;
+    if (length < 8 || s[2] != ':' || s[5] != ':') {
+        return -1;
+    }
+    *hour = parse_digits(s, 2);
+    *minute = parse_digits(s+3, 2);
+    *second = parse_digits(s+6, 2);
+    if (*hour < 0 || *hour > 23 || *minute < 0 || *minute > 59 || *second < 0 || *second > 59) {
+        return -1;
+    }
+    *microsecond = 0;
+    if (length > 9 && s[8] == '.') {
+        for (i=9, n=0; i<length && n<6 && s[i] >= '0' && s[i] <= '9'; i++, n++) {
+            *microsecond = *microsecond * 10 + (s[i] - '0');
+        }
+        for (; n<6; n++) {
+            *microsecond *= 10;
+        }
+    }
+    return 0;
+}
+
+// Parses YYYY-MM-DD HH:MI:SS[.ffffff] the same way as parse_time
+static int parse_timestamp(const unsigned char *s, const uint64_t length, int *year, int *month,
+        int *day, int *hour, int *minute, int *second, int *microsecond) {
+    if (length < 19 || s[4] != '-' || s[7] != '-' || s[10] != ' ') {
+        return -1;
+    }
+    *year = parse_digits(s, 4);
+    *month = parse_digits(s+5, 2);
+    *day = parse_digits(s+8, 2);
+    if (*year < 1 || *month < 1 || *month > 12 || *day < 1 || *day > 31) {
+        return -1;
+    }
+    return parse_time(s+11, length-11, hour, minute, second, microsecond);
 }
 
 // TODO: add switch for handling different types of common time/timestamp
 // or maybe not.  could just allow passing a date format like pandas
+// Values that do not have the Teradata layout are returned as strings
 PyObject* teradata_time_to_giraffez_time(unsigned char **data, const uint64_t column_length) {
-    struct tm tm;
-    char buffer[BUFFER_STRPTIME_SIZE];
-    memset(&tm, '\0', sizeof(tm));
-    memcpy(buffer, (char*)*data, column_length);
-    buffer[column_length] = '\0';
-    if (strptime(buffer, "%H:%M:%S", &tm) != NULL) {
+    int hour, minute, second, microsecond;
+    if (parse_time(*data, column_length, &hour, &minute, &second, &microsecond) == 0) {
+        *data += column_length;
+        return giraffez_time_from_time(hour, minute, second, microsecond);
+    }
+    return teradata_char_to_pystring(data, column_length);
+}
+
+PyObject* teradata_time_to_pytime(unsigned char **data, const uint64_t column_length) {
+    int hour, minute, second, microsecond;
+    if (parse_time(*data, column_length, &hour, &minute, &second, &microsecond) == 0) {
         *data += column_length;
-        return giraffez_time_from_time(tm.tm_hour, tm.tm_min, tm.tm_sec, 0);
+        return PyTime_FromTime(hour, minute, second, microsecond);
     }
     return teradata_char_to_pystring(data, column_length);
 }
 
 PyObject* teradata_ts_to_giraffez_ts(unsigned char **data, const uint64_t column_length) {
-    struct tm tm;
-    char buffer[BUFFER_STRPTIME_SIZE];
-    memset(&tm, '\0', sizeof(tm));
-    memcpy(buffer, (char*)*data, column_length);
-    buffer[column_length] = '\0';
-    if (strptime(buffer, "%Y-%m-%d %H:%M:%S", &tm) != NULL) {
+    int year, month, day, hour, minute, second, microsecond;
+    PyObject *ts, *length;
+    if (parse_timestamp(*data, column_length, &year, &month, &day, &hour, &minute, &second,
+            &microsecond) != 0) {
+        return teradata_char_to_pystring(data, column_length);
+    }
+    *data += column_length;
+    if ((ts = giraffez_ts_from_datetime(year, month, day, hour, minute, second, microsecond)) == NULL) {
+        return NULL;
+    }
+    // Keeps the precision of the column for Timestamp.to_string, the
+    // same as Timestamp.from_string (it defaults to None on the class)
+    if (column_length > 20) {
+        if ((length = PyLong_FromUnsignedLongLong(column_length)) == NULL
+                || PyObject_SetAttrString(ts, "_original_length", length) != 0) {
+            Py_XDECREF(length);
+            Py_DECREF(ts);
+            return NULL;
+        }
+        Py_DECREF(length);
+    }
+    return ts;
+}
+
+PyObject* teradata_ts_to_pydatetime(unsigned char **data, const uint64_t column_length) {
+    int year, month, day, hour, minute, second, microsecond;
+    if (parse_timestamp(*data, column_length, &year, &month, &day, &hour, &minute, &second,
+            &microsecond) != 0) {
+        return teradata_char_to_pystring(data, column_length);
+    }
+    *data += column_length;
+    return PyDateTime_FromDateAndTime(year, month, day, hour, minute, second, microsecond);
+}
+
+// Epoch values are computed from the same parse, with the time zone of
+// TIME/TIMESTAMP WITH TIME ZONE (a trailing +HH:MI or -HH:MI) applied so
+// that the result is always UTC.
+static int64_t parse_tz_offset_us(const unsigned char *s, const uint64_t length) {
+    int hour, minute;
+    if (length < 14 || (s[length-6] != '+' && s[length-6] != '-') || s[length-3] != ':') {
+        return 0;
+    }
+    if ((hour = parse_digits(s+length-5, 2)) < 0 || (minute = parse_digits(s+length-2, 2)) < 0) {
+        return 0;
+    }
+    return (s[length-6] == '-' ? -1 : 1) * (int64_t)(hour * 60 + minute) * 60 * 1000000;
+}
+
+int32_t teradata_dateint_to_days(int32_t l) {
+    l += 19000000;
+    return civil_to_days(l / 10000, (l % 10000) / 100, l % 100);
+}
+
+int teradata_time_to_epoch_us(const unsigned char *s, const uint64_t length, int64_t *us) {
+    int hour, minute, second, microsecond;
+    if (parse_time(s, length, &hour, &minute, &second, &microsecond) != 0) {
+        return -1;
+    }
+    *us = (int64_t)((hour * 60 + minute) * 60 + second) * 1000000 + microsecond;
+    *us -= parse_tz_offset_us(s, length);
+    // the UTC time of day may wrap around midnight
+    *us = (*us + USECS_PER_DAY) % USECS_PER_DAY;
+    return 0;
+}
+
+int teradata_ts_to_epoch_us(const unsigned char *s, const uint64_t length, int64_t *us) {
+    int year, month, day, hour, minute, second, microsecond;
+    if (parse_timestamp(s, length, &year, &month, &day, &hour, &minute, &second,
+            &microsecond) != 0) {
+        return -1;
+    }
+    *us = (int64_t)civil_to_days(year, month, day) * USECS_PER_DAY
+        + (int64_t)((hour * 60 + minute) * 60 + second) * 1000000 + microsecond;
+    *us -= parse_tz_offset_us(s, length);
+    return 0;
+}
+
+PyObject* teradata_date_to_epoch(unsigned char **data) {
+    int32_t l;
+    unpack_int32_t(data, &l);
+    return teradata_dateint_to_epoch(l);
+}
+
+PyObject* teradata_dateint_to_epoch(int32_t l) {
+    return PyLong_FromLong(teradata_dateint_to_days(l));
+}
+
+PyObject* teradata_time_to_epoch(unsigned char **data, const uint64_t column_length) {
+    int64_t us;
+    if (teradata_time_to_epoch_us(*data, column_length, &us) == 0) {
+        *data += column_length;
+        return PyLong_FromLongLong(us);
+    }
+    return teradata_char_to_pystring(data, column_length);
+}
+
+PyObject* teradata_ts_to_epoch(unsigned char **data, const uint64_t column_length) {
+    int64_t us;
+    if (teradata_ts_to_epoch_us(*data, column_length, &us) == 0) {
         *data += column_length;
-        return giraffez_ts_from_datetime(tm.tm_year+1900, tm.tm_mon+1, tm.tm_mday, tm.tm_hour,
-            tm.tm_min, tm.tm_sec, 0);
+        return PyLong_FromLongLong(us);
     }
     return teradata_char_to_pystring(data, column_length);
 }
@@ -378,80 +902,39 @@ int teradata_decimal_to_cstring(unsigned char **data, const uint64_t column_leng
 }
 
 int teradata_decimal8_to_cstring(unsigned char **data, const uint16_t column_scale, char *buf) {
-    int8_t b, x, y, scale;
+    int8_t b;
     unpack_int8_t(data, &b);
-    if (column_scale > 0) {
-        const char *fmt = b < 0 ? "-%d.%0*d" : "%d.%0*d";
-        scale = (int8_t)pow(10, column_scale);
-        x = abs(b / scale);
-        y = abs(b % scale);
-        return sprintf(buf, fmt, x, column_scale, y);
-    } else {
-        return sprintf(buf, "%d", b);
-    }
-    return -1;
+    return int64_decimal_to_cstring(b, column_scale, buf);
 }
 
 int teradata_decimal16_to_cstring(unsigned char **data, const uint16_t column_scale, char *buf) {
-    int16_t h, x, y, scale;
+    int16_t h;
     unpack_int16_t(data, &h);
-    if (column_scale > 0) {
-        const char *fmt = h < 0 ? "-%d.%0*d" : "%d.%0*d";
-        scale = (int16_t)pow(10, column_scale);
-        x = abs(h / scale);
-        y = abs(h % scale);
-        return sprintf(buf, fmt, x, column_scale, y);
-    } else {
-        return sprintf(buf, "%d", h);
-    }
-    return -1;
+    return int64_decimal_to_cstring(h, column_scale, buf);
 }
 
 int teradata_decimal32_to_cstring(unsigned char **data, const uint16_t column_scale, char *buf) {
-    int32_t l, x, y, scale;
+    int32_t l;
     unpack_int32_t(data, &l);
-    if (column_scale > 0) {
-        const char *fmt = l < 0 ? "-%d.%0*d" : "%d.%0*d";
-        scale = (int32_t)pow(10, column_scale);
-        x = labs(l / scale);
-        y = labs(l % scale);
-        return sprintf(buf, fmt, x, column_scale, y);
-    } else {
-        return sprintf(buf, "%d", l);
-    }
-    return -1;
+    return int64_decimal_to_cstring(l, column_scale, buf);
 }
 
 int teradata_decimal64_to_cstring(unsigned char **data, const uint16_t column_scale, char *buf) {
-    int64_t q, x, y, scale;
+    int64_t q;
     unpack_int64_t(data, &q);
-    if (column_scale > 0) {
-#ifdef _MSC_VER
-        const char *fmt = q < 0 ? "-%I64d.%0*I64d" : "%I64d.%0*I64d";
-#else
-        const char *fmt = q < 0 ? "-%lld.%0*lld" : "%lld.%0*lld";
-#endif
-        scale = (int64_t)pow(10, column_scale);
-        x = llabs(q / scale);
-        y = llabs(q % scale);
-        return sprintf(buf, fmt, x, column_scale, y);
-    } else {
-#ifdef _MSC_VER
-        return sprintf(buf, "%I64d", q);
-#elif defined(__APPLE__)
-        return sprintf(buf, "%lld", q);
-#else
-        return sprintf(buf, "%ld", q);
-#endif
-    }
-    return -1;
+    return int64_decimal_to_cstring(q, column_scale, buf);
 }
 
-int teradata_number_to_cstring(unsigned char **data, char *str) {
-    int i = 0, j = 0;
-    uint64_t d, r;
-    char buf[38];
-    int sign;
+// NUMBER values lie between 1E-130 and 1E125 in magnitude and have at
+// most 38 digits, which bounds the scale read from the value.
+#define NUMBER_MIN_WIRE_SCALE (-125)
+#define NUMBER_MAX_WIRE_SCALE (130 + 37)
+
+// Reads a NUMBER value as a sign extended 128-bit integer and its scale,
+// returning 0 if the value has zero length (which is 0) and -1 if the
+// scale is out of range.
+static int teradata_number_unpack(unsigned char **data, uint64_t *hi, uint64_t *lo, int *scale) {
+    int size;
     TeradataNumber n = {
         .length = 0,
         .scale = 0,
@@ -463,132 +946,143 @@ int teradata_number_to_cstring(unsigned char **data, char *str) {
     memcpy(&n.length, *data, sizeof(n.length));
     *data += sizeof(n.length);
     if (n.length == 0) {
-        str[0] = '0';
-        str[1] = '\0';
-        return 1;
+        *hi = *lo = 0;
+        *scale = 0;
+        return 0;
     }
     memcpy(&n.scale, *data, sizeof(n.scale));
     *data += sizeof(n.scale);
-    memcpy(n.data, *data, n.length-sizeof(n.scale));
-    *data += n.length-sizeof(n.scale);
-    sign = (n.data[n.length-3] >> 7) & 1;
-    if (sign) {
-        for (long unsigned int i = n.length - 2; i < sizeof(n.data); i++) {
-            n.data[i] = 0xff;
-        }
-        n.v1 = ~n.v1 + 1;
-        n.v2 = ~n.v2;
-        n.v3 = ~n.v3;
-        n.v4 = ~n.v4;
-        if (n.v1 == 0) {
-            n.v2 += 1;
-            if (n.v2 == 0) {
-                n.v3 += 1;
-                if (n.v3 == 0) {
-                    n.v4 += 1;
-                }
-            }
-        }
+    if (n.scale < NUMBER_MIN_WIRE_SCALE || n.scale > NUMBER_MAX_WIRE_SCALE) {
+        PyErr_Format(EncoderError, "NUMBER value has invalid scale %d", n.scale);
+        return -1;
     }
-    do {
-        r = n.v4;
-        d = r / 10;
-        r = ((r - d * 10) << 32) + n.v3;
-        n.v4 = d;
-        d = r / 10;
-        r = ((r - d * 10) << 32) + n.v2;
-        n.v3 = d;
-        d = r / 10;
-        r = ((r - d * 10) << 32) + n.v1;
-        n.v2 = d;
-        d = r / 10;
-        r = r - d * 10;
-        n.v1 = d;
-        buf[i++] = r + '0';
-    } while (i <= n.scale || n.v1 || n.v2 || n.v3 || n.v4);
-    if (sign) {
-        str[j++] = '-';
-    }
-
-    // leading zeros
-    if (n.scale > 0 && n.scale > i) {
-        for (int k=0;k<abs(n.scale);k++) {
-            str[j++] = '0';
-        }
+    // the value is at most 16 bytes, anything beyond that (or a length that
+    // does not cover the scale) is malformed and must not overrun n.data
+    size = n.length - (int)sizeof(n.scale);
+    if (size <= 0) {
+        *hi = *lo = 0;
+        *scale = n.scale;
+        return n.length;
+    }
+    memcpy(n.data, *data, size > (int)sizeof(n.data) ? sizeof(n.data) : (size_t)size);
+    *data += size;
+    if (size > (int)sizeof(n.data)) {
+        size = sizeof(n.data);
     }
-    while (i != 0) {
-        str[j++] = buf[--i];
+    // sign extend the value to 128 bits
+    if ((n.data[size-1] >> 7) & 1) {
+        memset(n.data + size, 0xff, sizeof(n.data) - size);
+    }
+    *hi = ((uint64_t)n.v4 << 32) | n.v3;
+    *lo = ((uint64_t)n.v2 << 32) | n.v1;
+    *scale = n.scale;
+    return n.length;
+}
+
+int teradata_number_to_cstring(unsigned char **data, char *str) {
+    uint64_t hi, lo;
+    int scale, n;
+    if ((n = teradata_number_unpack(data, &hi, &lo, &scale)) < 0) {
+        return -1;
     }
+    if (n == 0) {
+        str[0] = '0';
+        str[1] = '\0';
+        return 1;
+    }
+    return int128_decimal_to_cstring(hi, lo, scale, str);
+}
+
+int teradata_decimal128_to_cstring(unsigned char **data, const uint16_t column_scale, char *buf) {
+    uint64_t lo, hi;
+    unpack_uint64_t(data, &lo);
+    unpack_uint64_t(data, &hi);
+    return int128_decimal_to_cstring(hi, lo, column_scale, buf);
+}
+
+// Decimals are converted to float directly from the scaled integer.
+// When the integer fits in the 53 bit mantissa of a double and 10^scale
+// is exact (scale <= 22) a single division (or multiplication for the
+// negative scales of NUMBER) is correctly rounded.  Other values are
+// formatted and parsed by PyOS_string_to_double, which is also correctly
+// rounded.  The fast path requires that doubles are evaluated without
+// extra precision (FLT_EVAL_METHOD == 0), which rules out x87.
+static const double pow10_double[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static PyObject* cstring_decimal_to_pyfloat(const char *buf) {
+    double d = PyOS_string_to_double(buf, NULL, NULL);
+    if (d == -1.0 && PyErr_Occurred()) {
+        return NULL;
+    }
+    return PyFloat_FromDouble(d);
+}
 
-    // trailing zeros
-    if (n.scale < 0) {
-        for (int i=0;i<abs(n.scale);i++) {
-            str[j++] = '0';
+static PyObject* int64_decimal_to_pyfloat(int64_t v, int scale) {
+    char buf[BUFFER_ITEM_SIZE];
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    if (v > -(1LL << 53) && v < (1LL << 53)) {
+        if (scale >= 0 && scale <= 22) {
+            return PyFloat_FromDouble((double)v / pow10_double[scale]);
+        } else if (scale < 0 && scale >= -22) {
+            return PyFloat_FromDouble((double)v * pow10_double[-scale]);
         }
     }
-    str[j] = '\0';
+#endif
+    int64_decimal_to_cstring(v, scale, buf);
+    return cstring_decimal_to_pyfloat(buf);
+}
 
-    if (n.scale <= 0) {
-        return j;
+static PyObject* int128_decimal_to_pyfloat(uint64_t hi, uint64_t lo, int scale) {
+    char buf[BUFFER_ITEM_SIZE];
+    // values that fit in 64 bits are only a sign extension of lo
+    if (hi == ((lo >> 63) ? UINT64_MAX : 0)) {
+        return int64_decimal_to_pyfloat((int64_t)lo, scale);
     }
-    // insert decimal point
-    memmove(str + (j - n.scale) + 1, str + (j - n.scale), j);
-    str[(j++ - n.scale)] = '.';
-    return j;
+    int128_decimal_to_cstring(hi, lo, scale, buf);
+    return cstring_decimal_to_pyfloat(buf);
 }
 
+PyObject* teradata_decimal8_to_pyfloat(unsigned char **data, const uint16_t column_scale) {
+    int8_t b;
+    unpack_int8_t(data, &b);
+    return int64_decimal_to_pyfloat(b, column_scale);
+}
 
+PyObject* teradata_decimal16_to_pyfloat(unsigned char **data, const uint16_t column_scale) {
+    int16_t h;
+    unpack_int16_t(data, &h);
+    return int64_decimal_to_pyfloat(h, column_scale);
+}
 
-int teradata_decimal128_to_cstring(unsigned char **data, const uint16_t column_scale, char *buf) {
-    char s[38];
-    int i = 0, j = 0;
-    uint64_t complement, sign, r, d, Q;
+PyObject* teradata_decimal32_to_pyfloat(unsigned char **data, const uint16_t column_scale) {
+    int32_t l;
+    unpack_int32_t(data, &l);
+    return int64_decimal_to_pyfloat(l, column_scale);
+}
+
+PyObject* teradata_decimal64_to_pyfloat(unsigned char **data, const uint16_t column_scale) {
     int64_t q;
-    uint64_t n[4];
-    unpack_uint64_t(data, &Q);
     unpack_int64_t(data, &q);
-    sign = (q >> 63);
-    complement = q;
-    if (sign) {
-        complement = ~complement;
-        Q = ~Q + 1;
-        if (Q == 0) {
-            complement += 1;
-        }
-    }
-    n[0] = complement >> 32;
-    n[1] = complement & 0xffffffff;
-    n[2] = (Q >> 32) & 0xffffffff;
-    n[3] = Q & 0xffffffff;
-    memset(s, 0, sizeof(s));
-    do {
-        r = n[0];
-        d = r / 10;
-        r = ((r - d * 10) << 32) + n[1];
-        n[0] = d;
-        d = r / 10;
-        r = ((r - d * 10) << 32) + n[2];
-        n[1] = d;
-        d = r / 10;
-        r = ((r - d * 10) << 32) + n[3];
-        n[2] = d;
-        d = r / 10;
-        r = r - d * 10;
-        n[3] = d;
-        s[i] = r + '0';
-        i++;
-    } while (i <= column_scale || n[0] || n[1] || n[2] || n[3]);
-    if (sign) {
-        buf[j++] = '-';
-    }
-    while (i != 0) {
-        if (i == column_scale) {
-            buf[j++] = '.';
-        }
-        buf[j++] = s[--i];
+    return int64_decimal_to_pyfloat(q, column_scale);
+}
+
+PyObject* teradata_decimal128_to_pyfloat(unsigned char **data, const uint16_t column_scale) {
+    uint64_t lo, hi;
+    unpack_uint64_t(data, &lo);
+    unpack_uint64_t(data, &hi);
+    return int128_decimal_to_pyfloat(hi, lo, column_scale);
+}
+
+PyObject* teradata_number_to_pyfloat(unsigned char **data) {
+    uint64_t hi, lo;
+    int scale;
+    if (teradata_number_unpack(data, &hi, &lo, &scale) < 0) {
+        return NULL;
     }
-    buf[j] = '\0';
-    return j;
+    return int128_decimal_to_pyfloat(hi, lo, scale);
 }
 
 PyObject* cstring_to_pyfloat(const char *buf, const int length) {
@@ -608,8 +1102,164 @@ PyObject* cstring_to_giraffez_decimal(const char *buf, const int length) {
     return giraffez_decimal_from_pystring(cstring_to_pystring(buf, length));
 }
 
+// Unscaled values are given to Decimal as an int, which it converts
+// without parsing.  Scaled values still need the digits as a string:
+// constructing from a (sign, digits, exponent) tuple measured slower,
+// since the tuple is formatted back into a string by the decimal module,
+// and so did Decimal(int).scaleb(-scale) under an exact context, which
+// creates two intermediate decimals before the giraffez.Decimal.
+static PyObject* int64_decimal_to_giraffez_decimal(int64_t v, int scale) {
+    char buf[BUFFER_ITEM_SIZE];
+    int n;
+    if (scale == 0) {
+        return giraffez_decimal_from_pylong(PyLong_FromLongLong(v));
+    }
+    n = int64_decimal_to_cstring(v, scale, buf);
+    return giraffez_decimal_from_pystring(ascii_to_pystring(buf, n));
+}
+
+static PyObject* int128_decimal_to_giraffez_decimal(uint64_t hi, uint64_t lo, int scale) {
+    char buf[BUFFER_ITEM_SIZE];
+    int n;
+    if (hi == ((lo >> 63) ? UINT64_MAX : 0)) {
+        return int64_decimal_to_giraffez_decimal((int64_t)lo, scale);
+    }
+    n = int128_decimal_to_cstring(hi, lo, scale, buf);
+    return giraffez_decimal_from_pystring(ascii_to_pystring(buf, n));
+}
+
+PyObject* teradata_decimal8_to_giraffez_decimal(unsigned char **data, const uint16_t column_scale) {
+    int8_t b;
+    unpack_int8_t(data, &b);
+    return int64_decimal_to_giraffez_decimal(b, column_scale);
+}
+
+PyObject* teradata_decimal16_to_giraffez_decimal(unsigned char **data, const uint16_t column_scale) {
+    int16_t h;
+    unpack_int16_t(data, &h);
+    return int64_decimal_to_giraffez_decimal(h, column_scale);
+}
+
+PyObject* teradata_decimal32_to_giraffez_decimal(unsigned char **data, const uint16_t column_scale) {
+    int32_t l;
+    unpack_int32_t(data, &l);
+    return int64_decimal_to_giraffez_decimal(l, column_scale);
+}
+
+PyObject* teradata_decimal64_to_giraffez_decimal(unsigned char **data, const uint16_t column_scale) {
+    int64_t q;
+    unpack_int64_t(data, &q);
+    return int64_decimal_to_giraffez_decimal(q, column_scale);
+}
+
+PyObject* teradata_decimal128_to_giraffez_decimal(unsigned char **data, const uint16_t column_scale) {
+    uint64_t lo, hi;
+    unpack_uint64_t(data, &lo);
+    unpack_uint64_t(data, &hi);
+    return int128_decimal_to_giraffez_decimal(hi, lo, column_scale);
+}
+
+PyObject* teradata_number_to_giraffez_decimal(unsigned char **data) {
+    uint64_t hi, lo;
+    int scale;
+    if (teradata_number_unpack(data, &hi, &lo, &scale) < 0) {
+        return NULL;
+    }
+    return int128_decimal_to_giraffez_decimal(hi, lo, scale);
+}
+
+// Scaled integers are the unscaled value of the decimal, DECIMAL(p,s)
+// values are returned as is while NUMBER values (which carry their own
+// scale) are rescaled to the scale of the column.
+static PyObject* int128_to_pylong(uint64_t hi, uint64_t lo) {
+    PyObject *high, *shift, *low, *tmp, *obj;
+    if (hi == ((lo >> 63) ? UINT64_MAX : 0)) {
+        return PyLong_FromLongLong((int64_t)lo);
+    }
+    high = PyLong_FromLongLong((int64_t)hi);
+    shift = PyLong_FromLong(64);
+    low = PyLong_FromUnsignedLongLong(lo);
+    tmp = obj = NULL;
+    if (high != NULL && shift != NULL && low != NULL) {
+        if ((tmp = PyNumber_Lshift(high, shift)) != NULL) {
+            obj = PyNumber_Or(tmp, low);
+        }
+    }
+    Py_XDECREF(high);
+    Py_XDECREF(shift);
+    Py_XDECREF(low);
+    Py_XDECREF(tmp);
+    return obj;
+}
+
+static PyObject* pylong_pow10(int n) {
+    PyObject *base, *exp, *obj;
+    if (n < 20) {
+        return PyLong_FromUnsignedLongLong(pow10_u64[n]);
+    }
+    base = PyLong_FromLong(10);
+    exp = PyLong_FromLong(n);
+    obj = (base != NULL && exp != NULL) ? PyNumber_Power(base, exp, Py_None) : NULL;
+    Py_XDECREF(base);
+    Py_XDECREF(exp);
+    return obj;
+}
+
+PyObject* teradata_decimal128_to_scaled_pylong(unsigned char **data) {
+    uint64_t lo, hi;
+    unpack_uint64_t(data, &lo);
+    unpack_uint64_t(data, &hi);
+    return int128_to_pylong(hi, lo);
+}
+
+PyObject* teradata_number_to_scaled_pylong(unsigned char **data, const uint16_t column_scale) {
+    PyObject *v, *p, *q, *r, *obj = NULL;
+    uint64_t hi, lo;
+    int scale;
+    if (teradata_number_unpack(data, &hi, &lo, &scale) < 0) {
+        return NULL;
+    }
+    if ((v = int128_to_pylong(hi, lo)) == NULL || scale == column_scale) {
+        return v;
+    }
+    if ((p = pylong_pow10(abs((int)column_scale - scale))) == NULL) {
+        Py_DECREF(v);
+        return NULL;
+    }
+    if (scale < column_scale) {
+        obj = PyNumber_Multiply(v, p);
+    } else if ((q = PyNumber_Divmod(v, p)) != NULL) {
+        r = PyTuple_GET_ITEM(q, 1);
+        if (PyObject_IsTrue(r)) {
+            PyErr_Format(EncoderError, "NUMBER value has more than %d digits after the decimal point",
+                column_scale);
+        } else {
+            obj = PyTuple_GET_ITEM(q, 0);
+            Py_INCREF(obj);
+        }
+        Py_DECREF(q);
+    }
+    Py_DECREF(p);
+    Py_DECREF(v);
+    return obj;
+}
+
+// Used for decimals without a standard byte length, the digits of the
+// formatted value are the unscaled integer.
+PyObject* cstring_to_scaled_pylong(const char *buf, const int length) {
+    char digits[BUFFER_ITEM_SIZE];
+    int i, n = 0;
+    for (i=0; i<length && n<BUFFER_ITEM_SIZE-1; i++) {
+        if (buf[i] != '.') {
+            digits[n++] = buf[i];
+        }
+    }
+    digits[n] = '\0';
+    return PyLong_FromString(digits, NULL, 10);
+}
+
 PyObject* cstring_to_pystring(const char *buf, const int length) {
-    return PyUnicode_FromStringAndSize(buf, length);
+    return ascii_to_pystring(buf, length);
 }
 
 PyObject* pystring_from_cformat(const char *fmt, ...) {
@@ -623,7 +1273,35 @@ PyObject* pystring_from_cformat(const char *fmt, ...) {
 }
 
 // PACK
-PyObject* teradata_varchar_from_pystring(PyObject *s, unsigned char **buf, uint16_t *packed_length) {
+// Returns the bytes of a str in the session charset.  Any temporary
+// object holding the encoded bytes is returned in tmp and must be
+// released by the caller.
+static const char* pystring_encode(PyObject *s, const uint32_t charset, PyObject **tmp, Py_ssize_t *length) {
+#if PY_MAJOR_VERSION >= 3
+    // ASCII is the same in either charset and already stored as such
+    if (PyUnicode_IS_READY(s) && PyUnicode_IS_COMPACT_ASCII(s)) {
+        *length = PyUnicode_GET_LENGTH(s);
+        return (const char*)PyUnicode_1BYTE_DATA(s);
+    }
+#endif
+    if (charset == CHARSET_LATIN1) {
+        if ((*tmp = PyUnicode_AsLatin1String(s)) == NULL) {
+            return NULL;
+        }
+        *length = PyBytes_GET_SIZE(*tmp);
+        return PyBytes_AS_STRING(*tmp);
+    }
+#if PY_MAJOR_VERSION < 3
+    if ((*tmp = PyUnicode_AsEncodedString(s, "UTF-8", NULL)) == NULL) {
+        return NULL;
+    }
+    s = *tmp;
+#endif
+    return PyUnicode_AsUTF8AndSize(s, length);
+}
+
+PyObject* teradata_varchar_from_pystring(PyObject *s, const uint32_t charset, unsigned char **buf,
+        uint16_t *packed_length) {
     const char *str;
     Py_ssize_t length;
     PyObject *stmp = NULL, *utmp = NULL;
@@ -638,13 +1316,7 @@ PyObject* teradata_varchar_from_pystring(PyObject *s, unsigned char **buf, uint1
             goto error;
         }
     }
-#if PY_MAJOR_VERSION < 3
-    if ((stmp = PyUnicode_AsEncodedString(s, "UTF-8", NULL)) == NULL) {
-        goto error;
-    }
-    s = stmp;
-#endif
-    if ((str = PyUnicode_AsUTF8AndSize(s, &length)) == NULL) {
+    if ((str = pystring_encode(s, charset, &stmp, &length)) == NULL) {
         goto error;
     }
     if (length > TD_ROW_MAX_SIZE) {
@@ -661,18 +1333,8 @@ error:
     return NULL;
 }
 
-PyObject* teradata_datetime_from_pystring(PyObject *s, const uint16_t column_length, unsigned char **buf, uint16_t *packed_length) {
-    PyObject *ret = NULL, *temp = NULL;
-    if (!PyUnicode_Check(s) && !PyBytes_Check(s)) {
-        Py_RETURN_ERROR((temp = PyObject_Str(s)));
-        s = temp;
-    }
-    ret = teradata_char_from_pystring(s, column_length, buf, packed_length);
-    Py_XDECREF(temp);
-    return ret;
-}
-
-PyObject* teradata_char_from_pystring(PyObject *s, const uint16_t column_length, unsigned char **buf, uint16_t *packed_length) {
+PyObject* teradata_char_from_pystring(PyObject *s, const uint16_t column_length, const uint32_t charset,
+        unsigned char **buf, uint16_t *packed_length) {
     int fill;
     const char *str;
     Py_ssize_t length;
@@ -688,13 +1350,7 @@ PyObject* teradata_char_from_pystring(PyObject *s, const uint16_t column_length,
             goto error;
         }
     }
-#if PY_MAJOR_VERSION < 3
-    if ((stmp = PyUnicode_AsEncodedString(s, "UTF-8", NULL)) == NULL) {
-        goto error;
-    }
-    s = stmp;
-#endif
-    if ((str = PyUnicode_AsUTF8AndSize(s, &length)) == NULL) {
+    if ((str = pystring_encode(s, charset, &stmp, &length)) == NULL) {
         goto error;
     }
     if (length > TD_ROW_MAX_SIZE) {
@@ -843,253 +1499,718 @@ PyObject* teradata_float_from_pyfloat(PyObject *item, const uint16_t column_leng
     Py_RETURN_NONE;
 }
 
-PyObject* teradata_dateint_from_pystring(PyObject *item, const uint16_t column_length, unsigned char **buf, uint16_t *packed_length) {
-    PyObject *temp;
-    char *str;
-    struct tm tm;
-    int32_t l = 0;
-    
-    if (PyStr_Check(item)) {
-        Py_RETURN_ERROR((str = (char*)PyUnicode_AsUTF8(item)));
-    } else {
-        Py_RETURN_ERROR((temp = PyObject_Str(item)));
-        Py_RETURN_ERROR((str = (char*)PyUnicode_AsUTF8(temp)));
-        Py_DECREF(temp);
+// Dates, times and timestamps to load are parsed natively.  DATE values
+// may be in any of the formats of DateFormat, the format of a column is
+// detected from the first value and then kept for the rest of the load
+// (see EncodeOp) rather than trying every format for every value.  TIME
+// values are HH:MI[:SS[.ffffff]] and TIMESTAMP values are a date, in the
+// same formats as DATE, optionally followed by a time (separated by a
+// space or T).  Times are written in the layout of the column, the
+// fraction is zero padded or, if the digits are only zeros, truncated to
+// the precision of the column.
+
+// Reads between min and max digits, returning -1 if there are fewer
+static int read_digits(const char **s, const char *end, int min, int max, int *v) {
+    int n = 0;
+    *v = 0;
+    while (*s < end && n < max && **s >= '0' && **s <= '9') {
+        *v = *v * 10 + (*(*s)++ - '0');
+        n++;
     }
+    return n < min ? -1 : n;
+}
 
+static int date_is_valid(int year, int month, int day) {
+    static const int days[12] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (year < 1 || year > 9999 || month < 1 || month > 12 || day < 1 || day > days[month-1]) {
+        return 0;
+    }
+    return month != 2 || day < 29 || (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0));
+}
 
-    memset(&tm, '\0', sizeof(tm));
-    if (strptime(str, "%Y-%m-%d", &tm) == NULL) {
-        PyErr_Format(EncoderError, "Unable to parse date string '%s', format must be '%%Y-%%m-%%d'.", str);
-        return NULL;
+static int date_format_detect(const char *s, const char *end) {
+    const char *p = s;
+    int v, n;
+    if (p < end && *p == '-') {
+        return DATE_FORMAT_INTEGER;
+    }
+    if ((n = read_digits(&p, end, 1, 8, &v)) < 0) {
+        return DATE_FORMAT_DETECT;
+    }
+    if (p < end && *p == '-') {
+        return DATE_FORMAT_ISO;
+    } else if (p < end && *p == '/') {
+        return n > 2 ? DATE_FORMAT_ISO : DATE_FORMAT_US;
+    } else if (n == 8) {
+        return DATE_FORMAT_COMPACT;
+    } else if (p == end) {
+        return DATE_FORMAT_INTEGER;
+    }
+    return DATE_FORMAT_DETECT;
+}
+
+// Parses a date from the start of s, returning a pointer to what
+// follows it or NULL if it is not a date in the given format
+static const char* parse_date_text(const char *s, const char *end, int format, int *year,
+        int *month, int *day) {
+    int sep, negative = 0, v;
+    switch (format) {
+        case DATE_FORMAT_ISO:
+            if (read_digits(&s, end, 1, 4, year) < 0 || s == end || (*s != '-' && *s != '/')) {
+                return NULL;
+            }
+            sep = *s++;
+            if (read_digits(&s, end, 1, 2, month) < 0 || s == end || *s++ != sep
+                    || read_digits(&s, end, 1, 2, day) < 0) {
+                return NULL;
+            }
+            break;
+        case DATE_FORMAT_US:
+            if (read_digits(&s, end, 1, 2, month) < 0 || s == end || *s++ != '/'
+                    || read_digits(&s, end, 1, 2, day) < 0 || s == end || *s++ != '/'
+                    || read_digits(&s, end, 4, 4, year) < 0) {
+                return NULL;
+            }
+            break;
+        case DATE_FORMAT_COMPACT:
+            if (read_digits(&s, end, 8, 8, &v) < 0) {
+                return NULL;
+            }
+            *year = v / 10000;
+            *month = (v / 100) % 100;
+            *day = v % 100;
+            break;
+        case DATE_FORMAT_INTEGER:
+            if (s < end && *s == '-') {
+                negative = 1;
+                s++;
+            }
+            if (read_digits(&s, end, 1, 7, &v) < 0) {
+                return NULL;
+            }
+            v = (negative ? -v : v) + 19000000;
+            *year = v / 10000;
+            *month = (v / 100) % 100;
+            *day = v % 100;
+            break;
+        default:
+            return NULL;
     }
-    l += (tm.tm_year+1900) * 10000;
-    l += (tm.tm_mon+1) * 100;
-    l += tm.tm_mday;
+    return date_is_valid(*year, *month, *day) ? s : NULL;
+}
 
-    pack_int32_t(buf, l - 19000000);
-    *packed_length += 4;
-    Py_RETURN_NONE;
+// Parses HH:MI[:SS[.f...]], the fraction digits are returned as they are
+static const char* parse_time_text(const char *s, const char *end, int *hour, int *minute,
+        int *second, const char **fraction, int *fraction_length) {
+    *second = 0;
+    *fraction = NULL;
+    *fraction_length = 0;
+    if (read_digits(&s, end, 1, 2, hour) < 0 || s == end || *s++ != ':'
+            || read_digits(&s, end, 2, 2, minute) < 0) {
+        return NULL;
+    }
+    if (s < end && *s == ':') {
+        s++;
+        if (read_digits(&s, end, 2, 2, second) < 0) {
+            return NULL;
+        }
+        if (s < end && *s == '.') {
+            *fraction = ++s;
+            while (s < end && *s >= '0' && *s <= '9') {
+                s++;
+            }
+            *fraction_length = (int)(s - *fraction);
+        }
+    }
+    if (*hour > 23 || *minute > 59 || *second > 59) {
+        return NULL;
+    }
+    return s;
 }
 
-int strpos(const char *s, int c) {
-    char *ptr;
-    if ((ptr = strchr(s, c)) == NULL) {
-        return -1;
+// Writes HH:MI:SS[.ffffff] with precision digits of fraction, returning
+// the number of characters written or -1 if digits would be lost
+static int time_to_text(int hour, int minute, int second, const char *fraction,
+        int fraction_length, int precision, unsigned char *buf) {
+    int i;
+    for (i=precision; i<fraction_length; i++) {
+        if (fraction[i] != '0') {
+            return -1;
+        }
+    }
+    memcpy(buf, &digit_pairs[hour * 2], 2);
+    buf[2] = ':';
+    memcpy(buf+3, &digit_pairs[minute * 2], 2);
+    buf[5] = ':';
+    memcpy(buf+6, &digit_pairs[second * 2], 2);
+    if (precision == 0) {
+        return 8;
+    }
+    buf[8] = '.';
+    if (fraction_length > precision) {
+        fraction_length = precision;
+    }
+    memcpy(buf+9, fraction, fraction_length);
+    memset(buf+9+fraction_length, '0', precision - fraction_length);
+    return 9 + precision;
+}
+
+// Values that are already in the layout of the column (with the
+// precision of the column) are only validated and copied.  The layout is
+// checked 8 bytes at a time: XOR with the layout leaves 0-9 for a digit
+// (0 stands for a digit in the layout) and 0 for a separator, and adding
+// ts_layout_add (0x76 for a digit, 0x7f otherwise) sets the high bit of
+// any byte above that.
+static const char ts_layout[] = "0000-00-00 00:00:00.000000";
+static const char ts_layout_add[] =
+    "\x76\x76\x76\x76\x7f\x76\x76\x7f\x76\x76\x7f\x76\x76\x7f"
+    "\x76\x76\x7f\x76\x76\x7f\x76\x76\x76\x76\x76\x76";
+
+// Requires at least 8 bytes, the last word overlaps the one before it
+static int text_is_layout(const unsigned char *s, const int offset, const int length) {
+    uint64_t x, layout, add, invalid = 0;
+    int i, k;
+    for (i=0; i<length; i+=8) {
+        k = i + 8 > length ? length - 8 : i;
+        memcpy(&x, s+k, 8);
+        memcpy(&layout, ts_layout+offset+k, 8);
+        memcpy(&add, ts_layout_add+offset+k, 8);
+        x ^= layout;
+        invalid |= x | (x + add);
     }
-    return (int)(ptr-s);
+    return (invalid & 0x8080808080808080ULL) == 0;
 }
 
-int _clz(uint32_t x) {
-    int r = 0;
-    if (x < 1) return 0;
-    while (x >>= 1) r++;
-    return (31 - r);
+#define TWO_DIGITS(s) (((s)[0] - '0') * 10 + (s)[1] - '0')
+
+static int time_text_is_layout(const char *s, const char *end, int precision) {
+    const unsigned char *u = (const unsigned char*)s;
+    int length = precision > 0 ? 9 + precision : 8;
+    return end - s == length && precision <= 6 && text_is_layout(u, 11, length)
+        && TWO_DIGITS(u) <= 23 && TWO_DIGITS(u+3) <= 59 && TWO_DIGITS(u+6) <= 59;
 }
 
-#ifdef _MSC_VER
-  #define clz _clz
-#else
-  #define clz __builtin_clz
-#endif
+static int ts_text_is_layout(const char *s, const char *end, int precision) {
+    const unsigned char *u = (const unsigned char*)s;
+    int length = precision > 0 ? 20 + precision : 19;
+    return end - s == length && precision <= 6 && text_is_layout(u, 0, length)
+        && date_is_valid(TWO_DIGITS(u) * 100 + TWO_DIGITS(u+2), TWO_DIGITS(u+5), TWO_DIGITS(u+8))
+        && TWO_DIGITS(u+11) <= 23 && TWO_DIGITS(u+14) <= 59 && TWO_DIGITS(u+17) <= 59;
+}
 
-PyObject* teradata_number_from_pystring(PyObject *item, unsigned char **buf, uint16_t *packed_length) {
-    char *s;
-    int i, sign = 0, b, r, count = 0;
-    PyObject *n, *nn = NULL, *str, *zero, *mask, *shift;
-    int8_t length = 0;
-    int16_t scale = 0;
-    uint32_t L;
-    if (PyUnicode_Check(item)) {
-        str = item;
-        Py_INCREF(str);
+#define IS_BLANK(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+
+// Returns the text of a value to pack, str and bytes values are used as
+// they are and anything else is converted with str().  Leading and
+// trailing whitespace is skipped.  decimal.Decimal values also take this
+// path: str() is formatted by libmpdec and is faster than any of the
+// public accessors (as_tuple, as_integer_ratio, __reduce__), and the
+// _decimal internals are not exposed to extensions before Python 3.13.
+static const char* pyobject_text(PyObject *item, PyObject **tmp, const char **end) {
+    const char *s;
+    Py_ssize_t length;
+    if (PyBytes_Check(item)) {
+        s = PyBytes_AS_STRING(item);
+        length = PyBytes_GET_SIZE(item);
     } else {
-        if ((str = PyObject_Str(item)) == NULL) {
+        if (!PyUnicode_Check(item)) {
+            if ((*tmp = PyObject_Str(item)) == NULL) {
+                return NULL;
+            }
+            item = *tmp;
+        }
+#if PY_MAJOR_VERSION >= 3
+        if (PyUnicode_IS_READY(item) && PyUnicode_IS_COMPACT_ASCII(item)) {
+            s = (const char*)PyUnicode_1BYTE_DATA(item);
+            length = PyUnicode_GET_LENGTH(item);
+        } else
+#endif
+        if ((s = PyUnicode_AsUTF8AndSize(item, &length)) == NULL) {
             return NULL;
         }
     }
-    if ((s = strdup(PyUnicode_AsUTF8(str))) == NULL) {
-        Py_XDECREF(str);
+    *end = s + length;
+    while (s < *end && IS_BLANK(*s)) s++;
+    while (*end > s && IS_BLANK((*end)[-1])) (*end)--;
+    return s;
+}
+
+// Raises EncoderError with the message followed by the repr of the value
+static PyObject* pack_value_error(PyObject *item, const char *format, ...) {
+    char message[128];
+    PyObject *repr;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    if ((repr = PyObject_Repr(item)) == NULL) {
         return NULL;
-    };
-    Py_XDECREF(str);
-    if ((i = strpos(s, '.')) != -1) {
-        scale = strlen(s)-i-1;
-        memmove(&s[i], &s[i+1], strlen(s)-i);
     }
-    if ((i = strpos(s, '-')) != -1) {
-        sign = 1;
-        memmove(&s[i], &s[i+1], strlen(s)-i);
-    }
-
-    Py_RETURN_ERROR(n = PyLong_FromString(s, NULL, 10));
-    Py_RETURN_ERROR(zero = PyLong_FromLong(0));
-    Py_RETURN_ERROR(mask = PyLong_FromLong(4294967295));
-    Py_RETURN_ERROR(shift = PyLong_FromLong(32));
+    PyErr_Format(EncoderError, "%s: %s", message, PyUnicode_AsUTF8(repr));
+    Py_DECREF(repr);
+    return NULL;
+}
 
-    while (count < 5) {
-        if ((r = PyObject_RichCompareBool(n, zero, Py_EQ)) == -1) {
+static const char* date_format_name(int format) {
+    switch (format) {
+        case DATE_FORMAT_ISO:
+            return "YYYY-MM-DD";
+        case DATE_FORMAT_US:
+            return "MM/DD/YYYY";
+        case DATE_FORMAT_COMPACT:
+            return "YYYYMMDD";
+        case DATE_FORMAT_INTEGER:
+            return "a Teradata integer date";
+    }
+    return "not recognized";
+}
+
+// Integers are always taken as Teradata integer dates.  Anything may
+// follow a date that is not an integer date (such as the time of a
+// timestamp), which is ignored.
+PyObject* teradata_dateint_from_pystring(PyObject *item, const uint16_t column_length, int *format,
+        unsigned char **buf, uint16_t *packed_length) {
+    PyObject *tmp = NULL;
+    const char *s, *end, *p;
+    int detected = DATE_FORMAT_DETECT, year, month, day;
+    long l;
+    if (format == NULL) {
+        format = &detected;
+    }
+    if (PyLong_Check(item)) {
+        if ((l = PyLong_AsLong(item)) == -1 && PyErr_Occurred()) {
             return NULL;
         }
-        if (r) {
-            break;
+        l += 19000000;
+        if (!date_is_valid(l / 10000, (l / 100) % 100, l % 100)) {
+            return pack_value_error(item, "Unable to parse date, not a valid integer date");
         }
-        count++;
-        nn = PyNumber_And(n, mask);
-        L = PyLong_AsUnsignedLongLong(nn);
-
-        // Find the MSB to determine length of bytes written. Bitwise Or with 1
-        // is performed to handle possible input where the argument is 0.
-        b = clz(L | 1);
-        if (sign) {
-            L = ~L + 1;
+        pack_int32_t(buf, l - 19000000);
+        *packed_length += 4;
+        Py_RETURN_NONE;
+    }
+    // date and datetime objects (and subclasses such as pandas.Timestamp)
+    if (PyDate_Check(item)) {
+        year = PyDateTime_GET_YEAR(item);
+        month = PyDateTime_GET_MONTH(item);
+        day = PyDateTime_GET_DAY(item);
+        pack_int32_t(buf, year * 10000 + month * 100 + day - 19000000);
+        *packed_length += 4;
+        Py_RETURN_NONE;
+    }
+    if ((s = pyobject_text(item, &tmp, &end)) == NULL) {
+        Py_XDECREF(tmp);
+        return NULL;
+    }
+    if (*format == DATE_FORMAT_DETECT) {
+        *format = date_format_detect(s, end);
+    }
+    if ((p = parse_date_text(s, end, *format, &year, &month, &day)) == NULL
+            || (p != end && (*format == DATE_FORMAT_INTEGER || (*p != ' ' && *p != 'T')))) {
+        pack_value_error(item, "Unable to parse date, the date format of the column is %s",
+            date_format_name(*format));
+        Py_XDECREF(tmp);
+        return NULL;
+    }
+    Py_XDECREF(tmp);
+    pack_int32_t(buf, year * 10000 + month * 100 + day - 19000000);
+    *packed_length += 4;
+    Py_RETURN_NONE;
+}
+
+// TIME and TIMESTAMP values that cannot be parsed are copied as CHAR
+// text, the way every value was packed before they were parsed, and
+// are left to Teradata to accept or reject.
+static PyObject* datetime_text_from_pystring(PyObject *item, const uint16_t column_length,
+        unsigned char **buf, uint16_t *packed_length) {
+    PyObject *ret, *tmp = NULL;
+    if (!PyUnicode_Check(item) && !PyBytes_Check(item)) {
+        Py_RETURN_ERROR((tmp = PyObject_Str(item)));
+        item = tmp;
+    }
+    ret = teradata_char_from_pystring(item, column_length, CHARSET_UTF8, buf, packed_length);
+    Py_XDECREF(tmp);
+    return ret;
+}
+
+PyObject* teradata_time_from_pystring(PyObject *item, const uint16_t column_length, unsigned char **buf,
+        uint16_t *packed_length) {
+    PyObject *tmp = NULL;
+    const char *s, *end, *fraction;
+    int hour, minute, second, fraction_length, n;
+    int precision = column_length > 9 ? column_length - 9 : 0;
+    char digits[6];
+    if (PyTime_Check(item) && !_PyDateTime_HAS_TZINFO(item) && precision <= 6) {
+        uint64_digits_fixed(PyDateTime_TIME_GET_MICROSECOND(item), 6, digits+6);
+        if (time_to_text(PyDateTime_TIME_GET_HOUR(item), PyDateTime_TIME_GET_MINUTE(item),
+                PyDateTime_TIME_GET_SECOND(item), digits, 6, precision, *buf) < 0) {
+            return pack_value_error(item, "Time has more fractional digits than TIME(%d)", precision);
         }
-        memcpy(*buf+length, &L, sizeof(L));
-        length += (32 - b) / 8 + (b % 8 == 0 ? 0 : 1);
-        n = PyNumber_InPlaceRshift(n, shift);
+        *buf += column_length;
+        *packed_length += column_length;
+        Py_RETURN_NONE;
     }
-    (*buf)[length] = '\0';
-    memmove(*buf+sizeof(length)+sizeof(scale), *buf, length+1);
-    length += sizeof(scale);
-    memcpy(*buf, &length, sizeof(length));
-    memcpy(*buf+sizeof(length), &scale, sizeof(scale));
-    Py_DECREF(n);
-    Py_DECREF(zero);
-    Py_DECREF(mask);
-    Py_DECREF(shift);
-    Py_XDECREF(nn);
-    *packed_length += length+sizeof(length);
+    if ((s = pyobject_text(item, &tmp, &end)) == NULL) {
+        Py_XDECREF(tmp);
+        return NULL;
+    }
+    if (time_text_is_layout(s, end, precision)) {
+        memcpy(*buf, s, column_length);
+        Py_XDECREF(tmp);
+        *buf += column_length;
+        *packed_length += column_length;
+        Py_RETURN_NONE;
+    }
+    if (precision > 6 || (s = parse_time_text(s, end, &hour, &minute, &second, &fraction,
+            &fraction_length)) != end) {
+        Py_XDECREF(tmp);
+        return datetime_text_from_pystring(item, column_length, buf, packed_length);
+    }
+    n = time_to_text(hour, minute, second, fraction, fraction_length, precision, *buf);
+    Py_XDECREF(tmp);
+    if (n < 0) {
+        return pack_value_error(item, "Time has more fractional digits than TIME(%d)", precision);
+    }
+    *buf += column_length;
+    *packed_length += column_length;
     Py_RETURN_NONE;
 }
 
-PyObject* teradata_decimal_from_pystring(PyObject *item, const uint16_t column_length, const uint16_t column_scale, unsigned char **buf, uint16_t *packed_length) {
-    int8_t b; int16_t h; int32_t l; int64_t q; uint64_t Q;
-    char decbuf[BUFFER_ITEM_SIZE];
-    PyObject *str = NULL;
-    PyObject *dot = PyUnicode_FromString(".");
-    PyObject *parts;
-    Py_ssize_t ll;
-    const char *x = "", *y = "";
-    PyObject *a, *s;
-    PyObject *upper, *lower, *lower1, *shift;
-    if (PyUnicode_Check(item)) {
-        str = item;
-        Py_INCREF(str);
-    } else {
-        if ((str = PyObject_Str(item)) == NULL) {
-            return NULL;
+PyObject* teradata_ts_from_pystring(PyObject *item, const uint16_t column_length, int *format,
+        unsigned char **buf, uint16_t *packed_length) {
+    PyObject *tmp = NULL;
+    const char *s, *end, *fraction = NULL;
+    int detected = DATE_FORMAT_DETECT, year, month, day, hour = 0, minute = 0, second = 0;
+    int fraction_length = 0, n;
+    int precision = column_length > 20 ? column_length - 20 : 0;
+    char digits[6];
+    if (format == NULL) {
+        format = &detected;
+    }
+    // date and naive datetime objects, aware datetimes are left to fail
+    // parsing with their time zone
+    if (PyDate_Check(item) && !(PyDateTime_Check(item) && _PyDateTime_HAS_TZINFO(item))
+            && precision <= 6) {
+        if (PyDateTime_Check(item)) {
+            hour = PyDateTime_DATE_GET_HOUR(item);
+            minute = PyDateTime_DATE_GET_MINUTE(item);
+            second = PyDateTime_DATE_GET_SECOND(item);
+            uint64_digits_fixed(PyDateTime_DATE_GET_MICROSECOND(item), 6, digits+6);
+            fraction = digits;
+            fraction_length = 6;
         }
+        date_to_cstring(PyDateTime_GET_YEAR(item), PyDateTime_GET_MONTH(item), PyDateTime_GET_DAY(item),
+            (char*)*buf);
+        (*buf)[10] = ' ';
+        if (time_to_text(hour, minute, second, fraction, fraction_length, precision, *buf+11) < 0) {
+            return pack_value_error(item, "Timestamp has more fractional digits than TIMESTAMP(%d)",
+                precision);
+        }
+        *buf += column_length;
+        *packed_length += column_length;
+        Py_RETURN_NONE;
     }
-    if ((parts = PyUnicode_Split(str, dot, 1)) == NULL) {
+    if ((s = pyobject_text(item, &tmp, &end)) == NULL) {
+        Py_XDECREF(tmp);
         return NULL;
     }
-    Py_DECREF(dot);
-    ll = PyList_Size(parts);
-    if (ll == 1) {
-        if ((a = PyList_GetItem(parts, 0)) == NULL) {
-            Py_XDECREF(str);
-            return NULL;
+    if (*format == DATE_FORMAT_DETECT) {
+        *format = date_format_detect(s, end);
+    }
+    if (*format == DATE_FORMAT_ISO && ts_text_is_layout(s, end, precision)) {
+        memcpy(*buf, s, column_length);
+        Py_XDECREF(tmp);
+        *buf += column_length;
+        *packed_length += column_length;
+        Py_RETURN_NONE;
+    }
+    if (*format == DATE_FORMAT_INTEGER || precision > 6
+            || (s = parse_date_text(s, end, *format, &year, &month, &day)) == NULL
+            || (s != end && ((*s != ' ' && *s != 'T') || (s = parse_time_text(s+1, end, &hour,
+                &minute, &second, &fraction, &fraction_length)) != end))) {
+        Py_XDECREF(tmp);
+        return datetime_text_from_pystring(item, column_length, buf, packed_length);
+    }
+    date_to_cstring(year, month, day, (char*)*buf);
+    (*buf)[10] = ' ';
+    n = time_to_text(hour, minute, second, fraction, fraction_length, precision, *buf+11);
+    Py_XDECREF(tmp);
+    if (n < 0) {
+        return pack_value_error(item, "Timestamp has more fractional digits than TIMESTAMP(%d)", precision);
+    }
+    *buf += column_length;
+    *packed_length += column_length;
+    Py_RETURN_NONE;
+}
+
+// Decimal text is parsed straight into a 128-bit magnitude (hi:lo) using
+// 64-bit arithmetic only.  At most DECIMAL_MAX_DIGITS+2 significant
+// digits are kept, anything after them can only affect rounding.
+#define DECIMAL_MAX_DIGITS 39
+
+typedef struct DecimalText {
+    char    digits[DECIMAL_MAX_DIGITS+2];
+    int     length;    // significant digits, including those not kept
+    int     scale;     // digits after the decimal point, less the exponent
+    int     negative;
+    int     sticky;    // a non-zero digit was not kept
+} DecimalText;
+
+// Accepts an optional sign, digits with an optional decimal point and an
+// optional exponent.
+static int decimal_text_parse(const char *s, Py_ssize_t n, DecimalText *d) {
+    const char *end = s + n;
+    int ndigits = 0, exponent = 0, eneg = 0, point = 0;
+    memset(d, 0, sizeof(DecimalText));
+    if (s < end && (*s == '-' || *s == '+')) {
+        d->negative = *s++ == '-';
+    }
+    for (; s < end; s++) {
+        if (*s >= '0' && *s <= '9') {
+            ndigits++;
+            if (point) {
+                d->scale++;
+            }
+            if (d->length == 0 && *s == '0') {
+                continue;
+            }
+            if (d->length < (int)sizeof(d->digits)) {
+                d->digits[d->length] = *s - '0';
+            } else if (*s != '0') {
+                d->sticky = 1;
+            }
+            d->length++;
+        } else if (*s == '.' && !point) {
+            point = 1;
+        } else {
+            break;
         }
-        if ((x = PyUnicode_AsUTF8(a)) == NULL) {
-            Py_XDECREF(str);
-            return NULL;
+    }
+    if (ndigits == 0) {
+        return -1;
+    }
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        if (++s < end && (*s == '-' || *s == '+')) {
+            eneg = *s++ == '-';
         }
-    } else if (ll == 2) {
-        if ((a = PyList_GetItem(parts, 0)) == NULL) {
-            Py_XDECREF(str);
-            return NULL;
+        if (s == end) {
+            return -1;
         }
-        if ((x = PyUnicode_AsUTF8(a)) == NULL) {
-            Py_XDECREF(str);
-            return NULL;
+        for (; s < end && *s >= '0' && *s <= '9'; s++) {
+            if (exponent < 100000) {
+                exponent = exponent * 10 + (*s - '0');
+            }
         }
-        if ((a = PyList_GetItem(parts, 1)) == NULL) {
-            Py_XDECREF(str);
-            return NULL;
+        d->scale += eneg ? exponent : -exponent;
+    }
+    return s == end ? 0 : -1;
+}
+
+// hi:lo = hi:lo * m + a, returning -1 when the result needs more than
+// 128 bits
+static int uint128_mul_add(uint64_t *hi, uint64_t *lo, uint32_t m, uint32_t a) {
+    uint64_t l0 = (*lo & 0xffffffff) * m + a;
+    uint64_t l1 = (*lo >> 32) * m + (l0 >> 32);
+    uint64_t h0 = (*hi & 0xffffffff) * m + (l1 >> 32);
+    uint64_t h1 = (*hi >> 32) * m + (h0 >> 32);
+    if (h1 >> 32) {
+        return -1;
+    }
+    *lo = (l1 << 32) | (l0 & 0xffffffff);
+    *hi = (h1 << 32) | (h0 & 0xffffffff);
+    return 0;
+}
+
+// Aligns the parsed digits to scale as a magnitude, rounding any digits
+// dropped half to even (the default rounding of Teradata).
+static int decimal_text_to_uint128(const DecimalText *d, int scale, uint64_t *hi, uint64_t *lo) {
+    int i, kept = d->length, round = 0, sticky = d->sticky;
+    *hi = *lo = 0;
+    if (d->length == 0) {
+        return 0;
+    }
+    if (d->scale > scale) {
+        kept = d->length - (d->scale - scale);
+    }
+    if (kept > DECIMAL_MAX_DIGITS) {
+        return -1;
+    }
+    for (i=0; i<kept; i++) {
+        if (uint128_mul_add(hi, lo, 10, d->digits[i]) != 0) {
+            return -1;
         }
-        if ((y = PyUnicode_AsUTF8(a)) == NULL) {
-            Py_XDECREF(str);
-            return NULL;
+    }
+    if (kept < d->length && kept >= 0) {
+        round = d->digits[kept];
+        for (i=kept+1; i<d->length && i<(int)sizeof(d->digits); i++) {
+            sticky |= d->digits[i] != 0;
+        }
+        if (round > 5 || (round == 5 && (sticky || (*lo & 1)))) {
+            if (++*lo == 0) {
+                ++*hi;
+            }
         }
     }
-    memcpy(decbuf, x, strlen(x));
-    if (column_scale > strlen(y)) {
-        memcpy(decbuf+strlen(x), y, strlen(y));
-        memset(decbuf+strlen(x)+strlen(y), '0', column_scale - strlen(y));
-        decbuf[strlen(x)+column_scale] = '\0';
-    } else {
-        memcpy(decbuf+strlen(x), y, column_scale);
-        decbuf[strlen(x)+column_scale] = '\0';
+    for (i=d->scale; i<scale; i++) {
+        if (uint128_mul_add(hi, lo, 10, 0) != 0) {
+            return -1;
+        }
+        if (*hi == 0 && *lo == 0) {
+            break;
+        }
+    }
+    return 0;
+}
+
+// Negates the magnitude hi:lo into two's complement, returning -1 if it
+// does not fit in a signed integer of the given number of bits
+static int uint128_to_signed(uint64_t *hi, uint64_t *lo, int negative, int bits) {
+    uint64_t mhi = bits > 64 ? (uint64_t)1 << (bits - 65) : 0;
+    uint64_t mlo = bits > 64 ? 0 : (uint64_t)1 << (bits - 1);
+    // the magnitude must be below 2^(bits-1), or equal to it if negative
+    if (*hi > mhi || (*hi == mhi && (*lo > mlo || (*lo == mlo && !negative)))) {
+        return -1;
     }
-    Py_DECREF(parts);
-    if ((s = PyLong_FromString(decbuf, NULL, 10)) == NULL) {
-        PyObject *repr = PyObject_Repr(str);
+    if (negative) {
+        *lo = ~*lo + 1;
+        *hi = ~*hi + (*lo == 0);
+    }
+    return 0;
+}
+
+// Integers that fit in 64 bits are scaled without going through their
+// text, returning 0 for anything else and -1 if the scaled value would
+// need more than 128 bits.
+static int pylong_to_uint128(PyObject *item, int scale, int *negative, uint64_t *hi, uint64_t *lo) {
+    PY_LONG_LONG v;
+    int overflow, i;
+    if (!PyLong_CheckExact(item)) {
+        return 0;
+    }
+    if ((v = PyLong_AsLongLongAndOverflow(item, &overflow)) == -1 && (overflow || PyErr_Occurred())) {
         PyErr_Clear();
-        PyErr_Format(EncoderError, "value is not a valid decimal: %s", PyUnicode_AsUTF8(repr));
-        Py_XDECREF(repr);
-        Py_XDECREF(str);
-        return NULL;
+        return 0;
     }
-    Py_XDECREF(str);
-    shift = PyLong_FromLong(64);
+    *negative = v < 0;
+    *lo = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+    *hi = 0;
+    for (i=0; i<scale && (*hi | *lo) != 0; i++) {
+        if (uint128_mul_add(hi, lo, 10, 0) != 0) {
+            return -1;
+        }
+    }
+    return 1;
+}
+
+// NUMBER values are written with the length of the rest of the value
+// (int8), the scale (int16) and the smallest little-endian two's
+// complement integer holding the value.  Values are written with the
+// scale they are given in, rounded to at most NUMBER_MAX_SCALE digits.
+#define NUMBER_MAX_SCALE 38
+
+PyObject* teradata_number_from_pystring(PyObject *item, unsigned char **buf, uint16_t *packed_length) {
+    DecimalText d;
+    PyObject *tmp = NULL;
+    const char *s, *end;
+    uint64_t hi, lo;
+    unsigned char v[16];
+    int8_t length = 16;
+    int16_t scale = 0;
+    int i;
+    if ((i = pylong_to_uint128(item, 0, &d.negative, &hi, &lo)) == 0) {
+        if ((s = pyobject_text(item, &tmp, &end)) == NULL) {
+            Py_XDECREF(tmp);
+            return NULL;
+        }
+        if (decimal_text_parse(s, end - s, &d) != 0) {
+            pack_value_error(item, "value is not a valid decimal");
+            goto error;
+        }
+        scale = d.scale < 0 ? 0 : d.scale > NUMBER_MAX_SCALE ? NUMBER_MAX_SCALE : d.scale;
+        i = decimal_text_to_uint128(&d, scale, &hi, &lo) == 0 ? 1 : -1;
+    }
+    if (i < 0 || uint128_to_signed(&hi, &lo, d.negative, 128) != 0) {
+        pack_value_error(item, "value does not fit in NUMBER");
+        goto error;
+    }
+    Py_XDECREF(tmp);
+    for (i=0; i<8; i++) {
+        v[i] = (unsigned char)(lo >> (i * 8));
+        v[i+8] = (unsigned char)(hi >> (i * 8));
+    }
+    // drop the bytes that are only sign extension
+    while (length > 1 && ((v[length-1] == 0x00 && !(v[length-2] & 0x80))
+            || (v[length-1] == 0xff && (v[length-2] & 0x80)))) {
+        length--;
+    }
+    length += sizeof(scale);
+    memcpy(*buf, &length, sizeof(length));
+    memcpy(*buf+sizeof(length), &scale, sizeof(scale));
+    memcpy(*buf+sizeof(length)+sizeof(scale), v, length-sizeof(scale));
+    *buf += sizeof(length) + length;
+    *packed_length += sizeof(length) + length;
+    Py_RETURN_NONE;
+error:
+    Py_XDECREF(tmp);
+    return NULL;
+}
+
+PyObject* teradata_decimal_from_pystring(PyObject *item, const uint16_t column_length, const uint16_t column_scale, unsigned char **buf, uint16_t *packed_length) {
+    DecimalText d;
+    PyObject *tmp = NULL;
+    const char *s, *end;
+    uint64_t hi, lo;
+    int i;
     switch (column_length) {
         case DECIMAL8:
-            b = PyLong_AsLongLong(s);
-            if (b == -1 && PyErr_Occurred()) {
-                return NULL;
-            }
-            pack_int8_t(buf, b);
+        case DECIMAL16:
+        case DECIMAL32:
+        case DECIMAL64:
+        case DECIMAL128:
+            break;
+        default:
+            PyErr_Format(EncoderError, "Invalid DECIMAL length %d", column_length);
+            return NULL;
+    }
+    if ((i = pylong_to_uint128(item, column_scale, &d.negative, &hi, &lo)) == 0) {
+        if ((s = pyobject_text(item, &tmp, &end)) == NULL) {
+            Py_XDECREF(tmp);
+            return NULL;
+        }
+        if (decimal_text_parse(s, end - s, &d) != 0) {
+            pack_value_error(item, "value is not a valid decimal");
+            goto error;
+        }
+        i = decimal_text_to_uint128(&d, column_scale, &hi, &lo) == 0 ? 1 : -1;
+    }
+    if (i < 0 || uint128_to_signed(&hi, &lo, d.negative, column_length * 8) != 0) {
+        pack_value_error(item, "value does not fit in a %d byte DECIMAL", column_length);
+        goto error;
+    }
+    Py_XDECREF(tmp);
+    switch (column_length) {
+        case DECIMAL8:
+            pack_int8_t(buf, (int8_t)lo);
             break;
         case DECIMAL16:
-            h = PyLong_AsLongLong(s);
-            if (h == -1 && PyErr_Occurred()) {
-                return NULL;
-            }
-            pack_int16_t(buf, h);
+            pack_int16_t(buf, (int16_t)lo);
             break;
         case DECIMAL32:
-            l = PyLong_AsLongLong(s);
-            if (l == -1 && PyErr_Occurred()) {
-                return NULL;
-            }
-            pack_int32_t(buf, l);
+            pack_int32_t(buf, (int32_t)lo);
             break;
         case DECIMAL64:
-            q = PyLong_AsLongLong(s);
-            if (q == -1 && PyErr_Occurred()) {
-                return NULL;
-            }
-            pack_int64_t(buf, q);
+            pack_int64_t(buf, (int64_t)lo);
             break;
         case DECIMAL128:
-            if ((upper = PyNumber_Rshift(s, shift)) == NULL) {
-                return NULL;
-            }
-            if ((lower1 = PyNumber_Lshift(upper, shift)) == NULL) {
-                return NULL;
-            }
-            if ((lower = PyNumber_Xor(lower1, s)) == NULL) {
-                return NULL;
-            }
-            Q = PyLong_AsUnsignedLongLong(lower);
-            if (PyErr_Occurred()) {
-                return NULL;
-            }
-            q = PyLong_AsLongLong(upper);
-            if (q == -1 && PyErr_Occurred()) {
-                return NULL;
-            }
-            pack_uint64_t(buf, Q);
-            pack_int64_t(buf, q);
-            Py_DECREF(upper);
-            Py_DECREF(lower);
-            Py_DECREF(lower1);
+            pack_uint64_t(buf, lo);
+            pack_uint64_t(buf, hi);
             break;
     }
-    Py_DECREF(shift);
-    Py_DECREF(s);
     *packed_length += column_length;
     Py_RETURN_NONE;
+error:
+    Py_XDECREF(tmp);
+    return NULL;
 }
 
 static PyObject *ColumnsType;
@@ -1101,6 +2222,10 @@ static PyObject *TimestampType;
 
 int giraffez_types_import() {
     PyObject *mod;
+    PyDateTime_IMPORT;
+    if (PyDateTimeAPI == NULL) {
+        return -1;
+    }
     if ((mod = PyImport_ImportModule("giraffez.types")) == NULL) {
         return -1;
     };
@@ -1255,25 +2380,48 @@ GiraffeColumns* giraffez_columns_from_pyobject(PyObject *columns_obj) {
     return columns;
 }
 
+// The giraffez date/time types are created through the datetime C API, which
+// allocates the subclass directly without calling __init__, so
+// Timestamp._original_length is left to its class default.
 PyObject* giraffez_date_from_datetime(int year, int month, int day, int hour, int minute,
         int second, int microsecond) {
-    return PyObject_CallFunction(DateType, "iiiiiii", year, month, day, hour, minute, second,
-        microsecond);
+    return PyDateTimeAPI->DateTime_FromDateAndTime(year, month, day, hour, minute, second,
+        microsecond, Py_None, (PyTypeObject*)DateType);
 }
 
 PyObject* giraffez_time_from_time(int hour, int minute, int second, int microsecond) {
-    return PyObject_CallFunction(TimeType, "iiii", hour, minute, second, microsecond);
+    return PyDateTimeAPI->Time_FromTime(hour, minute, second, microsecond, Py_None,
+        (PyTypeObject*)TimeType);
 }
 
 PyObject* giraffez_ts_from_datetime(int year, int month, int day, int hour, int minute, int second,
         int microsecond) {
-    return PyObject_CallFunction(TimestampType, "iiiiiii", year, month, day, hour, minute, second,
-        microsecond);
+    return PyDateTimeAPI->DateTime_FromDateAndTime(year, month, day, hour, minute, second,
+        microsecond, Py_None, (PyTypeObject*)TimestampType);
 }
 
-PyObject* giraffez_decimal_from_pystring(PyObject *s) {
-    PyObject *obj;
-    obj = PyObject_CallFunction(DecimalType, "O", s);
-    Py_DECREF(s);
+// Calls tp_new directly, as giraffez.Decimal defines neither __new__ nor
+// __init__, which saves building the arguments from a format string and
+// the lookup of __init__ for every value.  The value is stolen.
+static PyObject* giraffez_decimal_new(PyObject *value) {
+    PyObject *args, *obj;
+    if (value == NULL) {
+        return NULL;
+    }
+    if ((args = PyTuple_New(1)) == NULL) {
+        Py_DECREF(value);
+        return NULL;
+    }
+    PyTuple_SET_ITEM(args, 0, value);
+    obj = ((PyTypeObject*)DecimalType)->tp_new((PyTypeObject*)DecimalType, args, NULL);
+    Py_DECREF(args);
     return obj;
 }
+
+PyObject* giraffez_decimal_from_pystring(PyObject *s) {
+    return giraffez_decimal_new(s);
+}
+
+PyObject* giraffez_decimal_from_pylong(PyObject *v) {
+    return giraffez_decimal_new(v);
+}
@@ -41,6 +41,16 @@ enum IntegerTypes {
     INTEGER64  =  8
 };
 
+// The formats of the dates being loaded, detected from the first value
+// of a column when DATE_FORMAT_DETECT
+enum DateFormat {
+    DATE_FORMAT_DETECT = 0,
+    DATE_FORMAT_ISO,      // YYYY-MM-DD or YYYY/MM/DD
+    DATE_FORMAT_US,       // MM/DD/YYYY
+    DATE_FORMAT_COMPACT,  // YYYYMMDD
+    DATE_FORMAT_INTEGER   // (YYYY-1900)*10000 + MM*100 + DD
+};
+
 typedef union {
     double d;
     unsigned char b[sizeof(double)];
@@ -68,13 +78,25 @@ void unpack_uchar(unsigned char **data, unsigned char **str);
 uint16_t unpack_string(unsigned char **data, char **str);
 
 // Character types
+int       is_ascii(const char *s, const size_t n);
+size_t    rtrim_length(const char *s, size_t n);
+PyObject* utf8_to_pystring(const char *s, const Py_ssize_t n);
+PyObject* latin1_to_pystring(const char *s, const Py_ssize_t n);
 PyObject* teradata_char_to_pystring(unsigned char **data, const uint64_t column_length);
 PyObject* teradata_char_to_pystring_f(unsigned char **data, const uint64_t column_length, const uint64_t format_length);
+PyObject* teradata_char_to_pystring_latin1(unsigned char **data, const uint64_t column_length, const uint64_t format_length);
+PyObject* teradata_char_to_pystring_trim(unsigned char **data, const uint64_t column_length,
+    const uint64_t format_length);
+PyObject* teradata_char_to_pystring_latin1_trim(unsigned char **data, const uint64_t column_length,
+    const uint64_t format_length);
 PyObject* teradata_byte_to_pybytes(unsigned char **data, const uint64_t column_length);
 PyObject* teradata_varchar_to_pystring(unsigned char **data);
+PyObject* teradata_varchar_to_pystring_latin1(unsigned char **data);
 PyObject* teradata_varbyte_to_pybytes(unsigned char **data);
 
 // Numeric types
+int       int64_to_cstring(int64_t v, char *buf);
+int       uint64_to_cstring(uint64_t v, char *buf);
 PyObject* teradata_byteint_to_pylong(unsigned char **data);
 PyObject* teradata_byteint_to_pystring(unsigned char **data);
 PyObject* teradata_smallint_to_pylong(unsigned char **data);
@@ -87,11 +109,30 @@ PyObject* teradata_float_to_pyfloat(unsigned char **data);
 PyObject* teradata_float_to_pystring(unsigned char **data);
 
 // Dates
+int date_to_cstring(int32_t year, int32_t month, int32_t day, char *buf);
 int teradata_date_to_cstring(unsigned char **data, char *buf);
 PyObject* teradata_date_to_giraffez_date(unsigned char **data);
+PyObject* teradata_date_to_pydate(unsigned char **data);
 PyObject* teradata_date_to_pystring(unsigned char **data);
+PyObject* teradata_dateint_to_giraffez_date(int32_t l);
+PyObject* teradata_dateint_to_pydate(int32_t l);
+PyObject* teradata_dateint_to_pystring(int32_t l);
+int32_t   civil_to_days(int32_t year, int32_t month, int32_t day);
 PyObject* teradata_time_to_giraffez_time(unsigned char **data, const uint64_t column_length);
+PyObject* teradata_time_to_pytime(unsigned char **data, const uint64_t column_length);
 PyObject* teradata_ts_to_giraffez_ts(unsigned char **data, const uint64_t column_length);
+PyObject* teradata_ts_to_pydatetime(unsigned char **data, const uint64_t column_length);
+
+// Epoch values: days since 1970-01-01 for DATE, microseconds since
+// midnight for TIME and microseconds since 1970-01-01 for TIMESTAMP
+#define USECS_PER_DAY 86400000000LL
+int32_t   teradata_dateint_to_days(int32_t l);
+int       teradata_time_to_epoch_us(const unsigned char *s, const uint64_t length, int64_t *us);
+int       teradata_ts_to_epoch_us(const unsigned char *s, const uint64_t length, int64_t *us);
+PyObject* teradata_date_to_epoch(unsigned char **data);
+PyObject* teradata_dateint_to_epoch(int32_t l);
+PyObject* teradata_time_to_epoch(unsigned char **data, const uint64_t column_length);
+PyObject* teradata_ts_to_epoch(unsigned char **data, const uint64_t column_length);
 
 // Decimal
 int teradata_decimal_to_cstring(unsigned char **data, const uint64_t column_length,
@@ -119,22 +160,37 @@ typedef struct TeradataNumber {
 
 int teradata_number_to_cstring(unsigned char **data, char *str);
 
+PyObject* teradata_decimal8_to_pyfloat(unsigned char **data, const uint16_t column_scale);
+PyObject* teradata_decimal16_to_pyfloat(unsigned char **data, const uint16_t column_scale);
+PyObject* teradata_decimal32_to_pyfloat(unsigned char **data, const uint16_t column_scale);
+PyObject* teradata_decimal64_to_pyfloat(unsigned char **data, const uint16_t column_scale);
+PyObject* teradata_decimal128_to_pyfloat(unsigned char **data, const uint16_t column_scale);
+PyObject* teradata_number_to_pyfloat(unsigned char **data);
+PyObject* teradata_decimal8_to_giraffez_decimal(unsigned char **data, const uint16_t column_scale);
+PyObject* teradata_decimal16_to_giraffez_decimal(unsigned char **data, const uint16_t column_scale);
+PyObject* teradata_decimal32_to_giraffez_decimal(unsigned char **data, const uint16_t column_scale);
+PyObject* teradata_decimal64_to_giraffez_decimal(unsigned char **data, const uint16_t column_scale);
+PyObject* teradata_decimal128_to_giraffez_decimal(unsigned char **data, const uint16_t column_scale);
+PyObject* teradata_number_to_giraffez_decimal(unsigned char **data);
+PyObject* teradata_decimal128_to_scaled_pylong(unsigned char **data);
+PyObject* teradata_number_to_scaled_pylong(unsigned char **data, const uint16_t column_scale);
+
 int teradata_decimal128_to_cstring(unsigned char **data, const uint16_t column_scale, char *buf);
 PyObject* teradata_number_from_pystring(PyObject *item, unsigned char **buf, uint16_t *packed_length);
 
 
 PyObject* cstring_to_pystring(const char *buf, const int length);
 PyObject* cstring_to_giraffez_decimal(const char *buf, const int length);
+PyObject* cstring_to_scaled_pylong(const char *buf, const int length);
 PyObject* cstring_to_pyfloat(const char *buf, const int length);
 PyObject* pystring_from_cformat(const char* fmt, ...);
 PyObject* pystring_to_pylong(PyObject *s);
 PyObject* pystring_to_pyfloat(PyObject *s);
 
 // PACK
-PyObject* teradata_varchar_from_pystring(PyObject *s, unsigned char **buf, uint16_t *packed_length);
-PyObject* teradata_char_from_pystring(PyObject *s, const uint16_t column_length,
-    unsigned char **buf, uint16_t *packed_length);
-PyObject* teradata_datetime_from_pystring(PyObject *s, const uint16_t column_length,
+PyObject* teradata_varchar_from_pystring(PyObject *s, const uint32_t charset, unsigned char **buf,
+    uint16_t *packed_length);
+PyObject* teradata_char_from_pystring(PyObject *s, const uint16_t column_length, const uint32_t charset,
     unsigned char **buf, uint16_t *packed_length);
 PyObject* teradata_byteint_from_pylong(PyObject *item, const uint16_t column_length,
     unsigned char **buf, uint16_t *packed_length);
@@ -146,7 +202,11 @@ PyObject* teradata_bigint_from_pylong(PyObject *item, const uint16_t column_leng
     unsigned char **buf, uint16_t *packed_length);
 PyObject* teradata_float_from_pyfloat(PyObject *item, const uint16_t column_length,
     unsigned char **buf, uint16_t *packed_length);
-PyObject* teradata_dateint_from_pystring(PyObject *item, const uint16_t column_length,
+PyObject* teradata_dateint_from_pystring(PyObject *item, const uint16_t column_length, int *format,
+    unsigned char **buf, uint16_t *packed_length);
+PyObject* teradata_time_from_pystring(PyObject *item, const uint16_t column_length,
+    unsigned char **buf, uint16_t *packed_length);
+PyObject* teradata_ts_from_pystring(PyObject *item, const uint16_t column_length, int *format,
     unsigned char **buf, uint16_t *packed_length);
 PyObject* teradata_decimal_from_pystring(PyObject *item, const uint16_t column_length,
     const uint16_t column_scale, unsigned char **buf, uint16_t *packed_length);
@@ -157,6 +217,7 @@ PyObject*       giraffez_columns_to_pyobject(GiraffeColumns *columns);
 GiraffeColumns* giraffez_columns_from_pyobject(PyObject *columns_obj);
 
 PyObject* giraffez_decimal_from_pystring(PyObject *obj);
+PyObject* giraffez_decimal_from_pylong(PyObject *obj);
 PyObject* giraffez_date_from_datetime(int year, int month, int day, int hour, int minute,
     int second, int microsecond);
 PyObject* giraffez_time_from_time(int hour, int minute, int second, int microsecond);
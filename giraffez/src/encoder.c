@@ -16,8 +16,11 @@
 
 #include "common.h"
 #include "buffer.h"
+#include "columnar.h"
 #include "columns.h"
 #include "convert.h"
+#include "plan.h"
+#include "record.h"
 #include "row.h"
 
 #include "encoder.h"
@@ -29,7 +32,17 @@ TeradataEncoder* encoder_new(GiraffeColumns *columns, uint32_t settings) {
     if (settings == 0) {
         settings = ENCODER_SETTINGS_DEFAULT;
     }
-    e->Columns = columns;
+    e->Owner = NULL;
+    e->Generation = 0;
+    e->Columns = NULL;
+    e->Plan = NULL;
+    e->PackPlan = NULL;
+    e->PlanSettings = 0;
+    e->PlanCharset = 0;
+    e->FixedRowLength = 0;
+    e->DateCache = NULL;
+    e->RowType = NULL;
+    e->Charset = CHARSET_UTF8;
     e->Settings = settings;
     e->Delimiter = NULL;
     e->NullValue = NULL;
@@ -39,7 +52,6 @@ TeradataEncoder* encoder_new(GiraffeColumns *columns, uint32_t settings) {
     e->NullValueStrLen = 0;
     e->buffer = buffer_new(TD_ROW_MAX_SIZE);
     e->PackRowFunc = NULL;
-    e->PackItemFunc = NULL;
     e->UnpackStmtInfoFunc = columns_from_stmtinfo;
     e->UnpackRowsFunc = NULL;
     e->UnpackRowFunc = NULL;
@@ -50,10 +62,25 @@ TeradataEncoder* encoder_new(GiraffeColumns *columns, uint32_t settings) {
     if (encoder_set_encoding(e, settings) != 0) {
         return NULL;
     }
+    if (encoder_set_columns(e, columns) != 0) {
+        return NULL;
+    }
     return e;
 }
 
+// The caller is responsible for the previous columns (see encoder_clear),
+// only the decode plan belonging to them is released here.
+int encoder_set_columns(TeradataEncoder *e, GiraffeColumns *columns) {
+    plan_free(e);
+    e->Columns = columns;
+    return plan_compile(e);
+}
+
+// Only the unpack functions and Settings change before the plan is
+// compiled, and a failed compile keeps the current plan, so the encoder
+// is restored as a whole on failure.
 int encoder_set_encoding(TeradataEncoder *e, uint32_t settings) {
+    TeradataEncoder previous = *e;
     // to switch on the value we just mask the particular byte
     switch (settings & ROW_RETURN_MASK) {
         case ROW_ENCODING_STRING:
@@ -61,31 +88,47 @@ int encoder_set_encoding(TeradataEncoder *e, uint32_t settings) {
             e->UnpackRowFunc = teradata_row_to_pystring;
             e->UnpackItemFunc = teradata_item_to_pyobject;
             e->PackRowFunc = teradata_row_from_pystring;
-            e->PackItemFunc = teradata_item_from_pyobject;
             break;
         case ROW_ENCODING_DICT:
             e->UnpackRowsFunc = teradata_buffer_to_pylist;
             e->UnpackRowFunc = teradata_row_to_pydict;
             e->UnpackItemFunc = teradata_item_to_pyobject;
             e->PackRowFunc = teradata_row_from_pydict;
-            e->PackItemFunc = teradata_item_from_pyobject;
             break;
         case ROW_ENCODING_LIST:
             e->UnpackRowsFunc = teradata_buffer_to_pylist;
             e->UnpackRowFunc = teradata_row_to_pytuple;
             e->UnpackItemFunc = teradata_item_to_pyobject;
             e->PackRowFunc = teradata_row_from_pytuple;
-            e->PackItemFunc = teradata_item_from_pyobject;
             break;
         case ROW_ENCODING_RAW:
             e->UnpackRowsFunc = teradata_buffer_to_pybytes;
             e->UnpackRowFunc = teradata_row_to_pybytes;
             e->UnpackItemFunc = teradata_item_to_pyobject;
             e->PackRowFunc = teradata_row_from_pybytes;
-            e->PackItemFunc = teradata_item_from_pyobject;
+            break;
+        case ROW_ENCODING_RECORD:
+            e->UnpackRowsFunc = teradata_buffer_to_pylist;
+            e->UnpackRowFunc = teradata_row_to_pyrecord;
+            e->UnpackItemFunc = teradata_item_to_pyobject;
+            e->PackRowFunc = teradata_row_from_pytuple;
+            break;
+        case ROW_ENCODING_LAZY:
+            e->UnpackRowsFunc = teradata_buffer_to_pylazy;
+            e->UnpackRowFunc = teradata_row_to_pylazy;
+            e->UnpackItemFunc = teradata_item_to_pyobject;
+            e->PackRowFunc = teradata_row_from_pytuple;
+            break;
+        case ROW_ENCODING_COLUMNAR:
+            // Columnar output only applies to whole buffers, individual
+            // rows are still returned as tuples
+            e->UnpackRowsFunc = teradata_buffer_to_columnar;
+            e->UnpackRowFunc = teradata_row_to_pytuple;
+            e->UnpackItemFunc = teradata_item_to_pyobject;
+            e->PackRowFunc = teradata_row_from_pytuple;
             break;
         default:
-            return -1;
+            goto error;
     }
     switch (settings & DATETIME_RETURN_MASK) {
         case DATETIME_AS_STRING:
@@ -98,8 +141,18 @@ int encoder_set_encoding(TeradataEncoder *e, uint32_t settings) {
             e->UnpackTimeFunc = teradata_time_to_giraffez_time;
             e->UnpackTimestampFunc = teradata_ts_to_giraffez_ts;
             break;
+        case DATETIME_AS_PYDATETIME:
+            e->UnpackDateFunc = teradata_date_to_pydate;
+            e->UnpackTimeFunc = teradata_time_to_pytime;
+            e->UnpackTimestampFunc = teradata_ts_to_pydatetime;
+            break;
+        case DATETIME_AS_EPOCH:
+            e->UnpackDateFunc = teradata_date_to_epoch;
+            e->UnpackTimeFunc = teradata_time_to_epoch;
+            e->UnpackTimestampFunc = teradata_ts_to_epoch;
+            break;
         default:
-            return -1;
+            goto error;
     }
     switch (settings & DECIMAL_RETURN_MASK) {
         case DECIMAL_AS_STRING:
@@ -111,79 +164,149 @@ int encoder_set_encoding(TeradataEncoder *e, uint32_t settings) {
         case DECIMAL_AS_GIRAFFEZ_DECIMAL:
             e->UnpackDecimalFunc = cstring_to_giraffez_decimal;
             break;
+        case DECIMAL_AS_SCALED_INT:
+            e->UnpackDecimalFunc = cstring_to_scaled_pylong;
+            break;
+        default:
+            goto error;
+    }
+    switch (settings & STRING_RETURN_MASK & ~STRING_TRIM_CHAR) {
+        case 0:
+        case STRING_AS_NEW:
+        case STRING_AS_INTERNED:
+            break;
         default:
-            return -1;
+            goto error;
     }
     e->Settings = settings;
+    if (plan_compile(e) != 0) {
+        goto error;
+    }
     return 0;
+error:
+    *e = previous;
+    return -1;
 }
 
-PyObject* encoder_set_delimiter(TeradataEncoder *e, PyObject *obj) {
-    PyObject *tmp = NULL;
-    const char *delimiter = NULL;
-    if (obj == NULL) {
-        Py_RETURN_NONE;
+// Accepts the Teradata session charset names (case-sensitive), LATIN1 is
+// short for LATIN1_0A.
+int encoder_set_charset(TeradataEncoder *e, const char *charset) {
+    uint32_t previous = e->Charset;
+    PyObject *r;
+    if (charset == NULL || strcmp(charset, "UTF8") == 0) {
+        e->Charset = CHARSET_UTF8;
+    } else if (strcmp(charset, "LATIN1") == 0 || strcmp(charset, "LATIN1_0A") == 0) {
+        e->Charset = CHARSET_LATIN1;
+    } else {
+        return -1;
     }
-    Py_XDECREF(e->Delimiter);
-    Py_INCREF(obj);
-    e->Delimiter = obj;
-    if (PyStr_Check(obj)) {
-        if ((delimiter = PyUnicode_AsUTF8(obj)) == NULL) {
-            return NULL;
+    // The delimiter and null strings are written into rows decoded in
+    // the session charset so they are encoded again
+    if ((r = encoder_set_delimiter(e, e->Delimiter)) == NULL) {
+        e->Charset = previous;
+        return -1;
+    }
+    Py_DECREF(r);
+    if ((r = encoder_set_null(e, e->NullValue)) == NULL) {
+        e->Charset = previous;
+        encoder_set_delimiter(e, e->Delimiter);
+        return -1;
+    }
+    Py_DECREF(r);
+    if (plan_compile(e) != 0) {
+        e->Charset = previous;
+        Py_XDECREF(encoder_set_delimiter(e, e->Delimiter));
+        Py_XDECREF(encoder_set_null(e, e->NullValue));
+        return -1;
+    }
+    return 0;
+}
+
+// The name of the session charset given to CLIv2 when connecting
+const char* encoder_charset_name(const TeradataEncoder *e) {
+    switch (e->Charset) {
+        case CHARSET_LATIN1:
+            return "LATIN1_0A";
+    }
+    return TERADATA_CHARSET;
+}
+
+// Returns a copy of the text of obj encoded in the session charset,
+// bytes are used as they are and anything else is converted with str().
+static char* encoder_text(const TeradataEncoder *e, PyObject *obj, size_t *length) {
+    PyObject *str = NULL, *bytes;
+    char *text;
+    if (PyBytes_Check(obj)) {
+        Py_INCREF(obj);
+        bytes = obj;
+    } else {
+        if (!PyUnicode_Check(obj)) {
+            if ((str = PyObject_Str(obj)) == NULL) {
+                return NULL;
+            }
+            obj = str;
         }
-    } else if (PyBytes_Check(obj)) {
-        if ((delimiter = PyBytes_AsString(obj)) == NULL) {
-            return NULL;
+        if (e->Charset == CHARSET_LATIN1) {
+            bytes = PyUnicode_AsLatin1String(obj);
+        } else {
+            bytes = PyUnicode_AsUTF8String(obj);
         }
-    } else {
-        tmp = PyObject_Str(obj);
-        if ((delimiter = PyUnicode_AsUTF8(tmp)) == NULL) {
+        Py_XDECREF(str);
+        if (bytes == NULL) {
             return NULL;
         }
     }
-    e->DelimiterStr = strdup(delimiter);
-    if (tmp != NULL) {
-        // decref here to prevent tmp from being deallocated before
-        // strdup is called
-        Py_DECREF(tmp);
+    *length = PyBytes_GET_SIZE(bytes);
+    if ((text = (char*)malloc(*length + 1)) == NULL) {
+        Py_DECREF(bytes);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    memcpy(text, PyBytes_AS_STRING(bytes), *length + 1);
+    Py_DECREF(bytes);
+    return text;
+}
+
+PyObject* encoder_set_delimiter(TeradataEncoder *e, PyObject *obj) {
+    char *delimiter;
+    size_t length;
+    if (obj == NULL) {
+        Py_RETURN_NONE;
+    }
+    if ((delimiter = encoder_text(e, obj, &length)) == NULL) {
+        return NULL;
     }
-    e->DelimiterStrLen = strlen(delimiter);
+    Py_INCREF(obj);
+    Py_XDECREF(e->Delimiter);
+    e->Delimiter = obj;
+    free(e->DelimiterStr);
+    e->DelimiterStr = delimiter;
+    e->DelimiterStrLen = length;
     Py_RETURN_NONE;
 }
 
 PyObject* encoder_set_null(TeradataEncoder *e, PyObject *obj) {
-    PyObject *tmp = NULL;
-    char *null = NULL;
+    char *null;
+    size_t length;
     if (obj == NULL) {
         Py_RETURN_NONE;
     }
-    Py_XDECREF(e->NullValue);
+    if ((null = encoder_text(e, obj, &length)) == NULL) {
+        return NULL;
+    }
     Py_INCREF(obj);
+    Py_XDECREF(e->NullValue);
     e->NullValue = obj;
-    if (PyStr_Check(obj)) {
-        if ((null = (char*)PyUnicode_AsUTF8(obj)) == NULL) {
-            return NULL;
-        }
-    } else if (PyBytes_Check(obj)) {
-        if ((null = PyBytes_AsString(obj)) == NULL) {
-            return NULL;
-        }
-    } else {
-        tmp = PyObject_Str(obj);
-        if ((null = (char*)PyUnicode_AsUTF8(tmp)) == NULL) {
-            return NULL;
-        }
-    }
-    e->NullValueStr = strdup(null);
-    if (tmp != NULL) {
-        // decref here to prevent tmp from being deallocated before strdup is called
-        Py_DECREF(tmp);
-    }
-    e->NullValueStrLen = strlen(e->NullValueStr);
+    free(e->NullValueStr);
+    e->NullValueStr = null;
+    e->NullValueStrLen = length;
     Py_RETURN_NONE;
 }
 
 void encoder_clear(TeradataEncoder *e) {
+    if (e != NULL) {
+        plan_free(e);
+    }
     if (e != NULL && e->Columns != NULL) {
         columns_free(e->Columns);
         e->Columns = NULL;
@@ -32,6 +32,9 @@ enum RowEncodingType {
     ROW_ENCODING_DICT     = 0x02,
     ROW_ENCODING_LIST     = 0x04,
     ROW_ENCODING_RAW      = 0x08,
+    ROW_ENCODING_COLUMNAR = 0x10,
+    ROW_ENCODING_RECORD   = 0x20,
+    ROW_ENCODING_LAZY     = 0x40,
     ROW_RETURN_MASK       = 0xff,
 };
 
@@ -39,6 +42,8 @@ enum DateTimeReturnType {
     DATETIME_AS_INVALID        = 0x0000,
     DATETIME_AS_STRING         = 0x0100,
     DATETIME_AS_GIRAFFE_TYPES  = 0x0200,
+    DATETIME_AS_PYDATETIME     = 0x0400,
+    DATETIME_AS_EPOCH          = 0x0800,
     DATETIME_RETURN_MASK       = 0xff00,
 };
 
@@ -47,11 +52,93 @@ enum DecimalReturnType {
     DECIMAL_AS_STRING           = 0x010000,
     DECIMAL_AS_FLOAT            = 0x020000,
     DECIMAL_AS_GIRAFFEZ_DECIMAL = 0x040000,
+    DECIMAL_AS_SCALED_INT       = 0x080000,
     DECIMAL_RETURN_MASK         = 0xff0000,
 };
 
+// Interning is opt-in, an encoding without this byte set (0) behaves as
+// STRING_AS_NEW.  STRING_TRIM_CHAR removes the padding of CHAR values and
+// is combined with either of them (STRING_AS_INTERNED|STRING_TRIM_CHAR).
+enum StringReturnType {
+    STRING_AS_NEW         = 0x01000000,
+    STRING_AS_INTERNED    = 0x02000000,
+    STRING_TRIM_CHAR      = 0x10000000,
+    STRING_RETURN_MASK    = 0xff000000,
+};
+
+struct TeradataEncoder;
+
+typedef PyObject *(*UnpackItemOp)(const struct TeradataEncoder*, unsigned char**, const GiraffeColumn*);
+typedef int       (*WriteItemOp) (const struct TeradataEncoder*, unsigned char**, const GiraffeColumn*);
+typedef int       (*PackItemOp)  (const struct TeradataEncoder*, const GiraffeColumn*, PyObject*,
+    unsigned char**, uint16_t*);
+
+// Bounded cache of the strings decoded for a single CHAR/VARCHAR column,
+// keyed on the raw bytes (see plan.h)
+#define STRING_CACHE_SIZE       256
+#define STRING_CACHE_MAX_LENGTH 64
+#define STRING_CACHE_WINDOW     4096
+
+typedef struct StringCacheEntry {
+    PyObject *value;
+    uint16_t length;
+    char     data[STRING_CACHE_MAX_LENGTH];
+} StringCacheEntry;
+
+typedef struct StringCache {
+    uint32_t         lookups;
+    uint32_t         hits;
+    StringCacheEntry entries[STRING_CACHE_SIZE];
+} StringCache;
+
+// A single step of the compiled decode plan (see plan.h).  The offset
+// from the start of the row (indicator header included) is only valid
+// when the encoder has a FixedRowLength.  Interned columns keep the
+// uncached handler in base.  The key is the column title, created once
+// for ROW_ENCODING_DICT.
+typedef struct DecodeOp {
+    UnpackItemOp unpack;
+    WriteItemOp  write;
+    size_t       offset;
+    UnpackItemOp base;
+    StringCache  *cache;
+    PyObject     *key;
+} DecodeOp;
+
+// A single step of the compiled pack plan (see plan.h).  The key is the
+// column name, created once for ROW_ENCODING_DICT.  The date format of
+// DATE and TIMESTAMP columns is detected from the first value packed.
+typedef struct EncodeOp {
+    PackItemOp pack;
+    PyObject   *key;
+    int        date_format;
+} EncodeOp;
+
+// Direct-mapped cache of converted DATE values keyed on the raw value,
+// the slot is empty while value is NULL (see plan.h)
+#define DATE_CACHE_SIZE 1024
+
+typedef struct DateCacheEntry {
+    int32_t  key;
+    PyObject *value;
+} DateCacheEntry;
+
+// Owner is the Python object the encoder belongs to (borrowed), which
+// lazy rows keep alive.  Generation changes every time the plan is
+// released, so lazy rows can tell that their columns are gone.
+// PlanSettings and PlanCharset are the values the plan was compiled with.
 typedef struct TeradataEncoder {
+    PyObject       *Owner;
+    uint32_t       Generation;
     GiraffeColumns *Columns;
+    DecodeOp       *Plan;
+    EncodeOp       *PackPlan;
+    uint32_t       PlanSettings;
+    uint32_t       PlanCharset;
+    uint32_t       FixedRowLength;
+    DateCacheEntry *DateCache;
+    PyObject       *RowType;
+    uint32_t       Charset;
     PyObject       *Delimiter;
     PyObject       *NullValue;
     uint32_t       Settings;
@@ -64,7 +151,6 @@ typedef struct TeradataEncoder {
     GiraffeColumns *(*UnpackStmtInfoFunc)  (unsigned char**, const uint32_t);
 
     PyObject *(*PackRowFunc)  (const struct TeradataEncoder*, PyObject*, unsigned char**, uint16_t*);
-    PyObject *(*PackItemFunc) (const struct TeradataEncoder*, const GiraffeColumn*, PyObject*, unsigned char**, uint16_t*);
 
     PyObject *(*UnpackRowsFunc) (const struct TeradataEncoder*, unsigned char**, const uint32_t);
     PyObject *(*UnpackRowFunc)  (const struct TeradataEncoder*, unsigned char**, const uint16_t);
@@ -79,7 +165,10 @@ typedef struct TeradataEncoder {
 typedef PyObject *(*EncoderFunc)(const TeradataEncoder*, unsigned char**, const uint16_t);
 
 TeradataEncoder* encoder_new(GiraffeColumns *columns, uint32_t settings);
+int              encoder_set_columns(TeradataEncoder *e, GiraffeColumns *columns);
 int              encoder_set_encoding(TeradataEncoder *e, uint32_t settings);
+int              encoder_set_charset(TeradataEncoder *e, const char *charset);
+const char*      encoder_charset_name(const TeradataEncoder *e);
 PyObject*        encoder_set_delimiter(TeradataEncoder *e, PyObject *obj);
 PyObject*        encoder_set_null(TeradataEncoder *e, PyObject *obj);
 void             encoder_clear(TeradataEncoder *e);
@@ -0,0 +1,314 @@
+/*
+ * Copyright 2016 Capital One Services, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Double to string conversion using the Grisu2 algorithm described in
+// "Printing Floating-Point Numbers Quickly and Accurately with Integers"
+// (Florian Loitsch, 2010).  The digits produced always round-trip and
+// are the shortest possible for all but a very small fraction of values,
+// where one extra digit may be produced.
+
+#include "common.h"
+
+#include "grisu.h"
+
+
+#define DP_SIGNIFICAND_MASK 0x000fffffffffffffULL
+#define DP_EXPONENT_MASK    0x7ff0000000000000ULL
+#define DP_HIDDEN_BIT       0x0010000000000000ULL
+#define DP_SIGNIFICAND_SIZE 52
+#define DP_EXPONENT_BIAS    (0x3ff + DP_SIGNIFICAND_SIZE)
+#define DP_MIN_EXPONENT     (-DP_EXPONENT_BIAS + 1)
+
+typedef struct diyfp {
+    uint64_t f;
+    int      e;
+} diyfp;
+
+// Normalized powers of ten 10^-348, 10^-340, ..., 10^340
+static const uint64_t cached_powers_f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+
+static const int16_t cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066
+};
+
+static const uint64_t pow10_table[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static diyfp diyfp_make(uint64_t f, int e) {
+    diyfp r;
+    r.f = f;
+    r.e = e;
+    return r;
+}
+
+static diyfp diyfp_from_double(double d) {
+    uint64_t u, significand;
+    int biased_e;
+    memcpy(&u, &d, sizeof(u));
+    biased_e = (int)((u & DP_EXPONENT_MASK) >> DP_SIGNIFICAND_SIZE);
+    significand = u & DP_SIGNIFICAND_MASK;
+    if (biased_e != 0) {
+        return diyfp_make(significand + DP_HIDDEN_BIT, biased_e - DP_EXPONENT_BIAS);
+    }
+    return diyfp_make(significand, DP_MIN_EXPONENT);
+}
+
+static diyfp diyfp_sub(diyfp a, diyfp b) {
+    return diyfp_make(a.f - b.f, a.e);
+}
+
+// The upper 64 bits of the 128-bit product, rounded
+static diyfp diyfp_mul(diyfp a, diyfp b) {
+    const uint64_t M32 = 0xffffffffULL;
+    uint64_t a1 = a.f >> 32, a0 = a.f & M32;
+    uint64_t b1 = b.f >> 32, b0 = b.f & M32;
+    uint64_t p11 = a1 * b1, p01 = a0 * b1, p10 = a1 * b0, p00 = a0 * b0;
+    uint64_t tmp = (p00 >> 32) + (p10 & M32) + (p01 & M32);
+    tmp += 1ULL << 31;
+    return diyfp_make(p11 + (p10 >> 32) + (p01 >> 32) + (tmp >> 32), a.e + b.e + 64);
+}
+
+static diyfp diyfp_normalize(diyfp a) {
+    while (!(a.f & 0x8000000000000000ULL)) {
+        a.f <<= 1;
+        a.e--;
+    }
+    return a;
+}
+
+static void diyfp_boundaries(double d, diyfp *minus, diyfp *plus) {
+    diyfp v = diyfp_from_double(d);
+    diyfp p = diyfp_make((v.f << 1) + 1, v.e - 1);
+    diyfp m;
+    while (!(p.f & (DP_HIDDEN_BIT << 1))) {
+        p.f <<= 1;
+        p.e--;
+    }
+    p.f <<= 64 - DP_SIGNIFICAND_SIZE - 2;
+    p.e -= 64 - DP_SIGNIFICAND_SIZE - 2;
+    // the lower boundary is closer when the significand is a power of two
+    if (v.f == DP_HIDDEN_BIT) {
+        m = diyfp_make((v.f << 2) - 1, v.e - 2);
+    } else {
+        m = diyfp_make((v.f << 1) - 1, v.e - 1);
+    }
+    m.f <<= m.e - p.e;
+    m.e = p.e;
+    *plus = p;
+    *minus = m;
+}
+
+static diyfp cached_power(int e, int *k) {
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+    unsigned index;
+    if (dk - ik > 0.0) {
+        ik++;
+    }
+    index = (unsigned)((ik >> 3) + 1);
+    *k = -(-348 + (int)(index << 3));
+    return diyfp_make(cached_powers_f[index], cached_powers_e[index]);
+}
+
+static void grisu_round(char *buf, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa,
+        uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+            (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buf[len-1]--;
+        rest += ten_kappa;
+    }
+}
+
+static int count_digits(uint32_t n) {
+    int i;
+    for (i=1; i<10; i++) {
+        if (n < pow10_table[i]) {
+            return i;
+        }
+    }
+    return 10;
+}
+
+static void digit_gen(diyfp w, diyfp mp, uint64_t delta, char *buf, int *len, int *k) {
+    diyfp one = diyfp_make(1ULL << -mp.e, mp.e);
+    diyfp wp_w = diyfp_sub(mp, w);
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    uint64_t tmp;
+    int kappa = count_digits(p1);
+    int d;
+    *len = 0;
+    while (kappa > 0) {
+        d = (int)(p1 / pow10_table[kappa-1]);
+        p1 %= (uint32_t)pow10_table[kappa-1];
+        if (d || *len) {
+            buf[(*len)++] = (char)('0' + d);
+        }
+        kappa--;
+        tmp = ((uint64_t)p1 << -one.e) + p2;
+        if (tmp <= delta) {
+            *k += kappa;
+            grisu_round(buf, *len, delta, tmp, pow10_table[kappa] << -one.e, wp_w.f);
+            return;
+        }
+    }
+    for (;;) {
+        p2 *= 10;
+        delta *= 10;
+        d = (int)(p2 >> -one.e);
+        if (d || *len) {
+            buf[(*len)++] = (char)('0' + d);
+        }
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *k += kappa;
+            grisu_round(buf, *len, delta, p2, one.f, -kappa < 20 ? wp_w.f * pow10_table[-kappa] : 0);
+            return;
+        }
+    }
+}
+
+// Writes the significant digits of a positive, finite, non-zero value to
+// buf and returns their count, the value being digits * 10^k.
+static int grisu2(double d, char *buf, int *k) {
+    diyfp v = diyfp_from_double(d);
+    diyfp w_m, w_p, c_mk, w, wp, wm;
+    int len;
+    diyfp_boundaries(d, &w_m, &w_p);
+    c_mk = cached_power(w_p.e, k);
+    w = diyfp_mul(diyfp_normalize(v), c_mk);
+    wp = diyfp_mul(w_p, c_mk);
+    wm = diyfp_mul(w_m, c_mk);
+    wm.f++;
+    wp.f--;
+    digit_gen(w, wp, wp.f - wm.f, buf, &len, k);
+    return len;
+}
+
+int double_to_cstring(double d, char *buf) {
+    char digits[24];
+    char *p = buf;
+    uint64_t u;
+    int len, k, exp10, i;
+    memcpy(&u, &d, sizeof(u));
+    if ((u & DP_EXPONENT_MASK) == DP_EXPONENT_MASK) {
+        if (u & DP_SIGNIFICAND_MASK) {
+            memcpy(buf, "nan", 3);
+            return 3;
+        }
+        if (u >> 63) {
+            *p++ = '-';
+        }
+        memcpy(p, "inf", 3);
+        return (int)(p - buf) + 3;
+    }
+    if (u >> 63) {
+        *p++ = '-';
+        d = -d;
+    }
+    if (d == 0.0) {
+        *p++ = '0';
+        return (int)(p - buf);
+    }
+    len = grisu2(d, digits, &k);
+    exp10 = len + k - 1;
+    // Same choice between fixed and exponent notation as "%.16g"
+    if (exp10 < -4 || exp10 >= 16) {
+        *p++ = digits[0];
+        if (len > 1) {
+            *p++ = '.';
+            memcpy(p, digits+1, len-1);
+            p += len-1;
+        }
+        *p++ = 'e';
+        if (exp10 < 0) {
+            *p++ = '-';
+            exp10 = -exp10;
+        } else {
+            *p++ = '+';
+        }
+        if (exp10 >= 100) {
+            *p++ = (char)('0' + exp10 / 100);
+            exp10 %= 100;
+        }
+        *p++ = (char)('0' + exp10 / 10);
+        *p++ = (char)('0' + exp10 % 10);
+    } else if (exp10 < 0) {
+        *p++ = '0';
+        *p++ = '.';
+        for (i=-1; i>exp10; i--) {
+            *p++ = '0';
+        }
+        memcpy(p, digits, len);
+        p += len;
+    } else if (len <= exp10 + 1) {
+        memcpy(p, digits, len);
+        p += len;
+        for (i=len; i<=exp10; i++) {
+            *p++ = '0';
+        }
+    } else {
+        memcpy(p, digits, exp10 + 1);
+        p += exp10 + 1;
+        *p++ = '.';
+        memcpy(p, digits + exp10 + 1, len - exp10 - 1);
+        p += len - exp10 - 1;
+    }
+    return (int)(p - buf);
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2016 Capital One Services, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GIRAFFEZ_GRISU_H
+#define __GIRAFFEZ_GRISU_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+
+
+// Writes the shortest representation of d that parses back to the same
+// value, choosing between fixed and exponent notation the same way as
+// "%.16g".  buf must hold at least 25 bytes and is not NUL terminated.
+int double_to_cstring(double d, char *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,775 @@
+/*
+ * Copyright 2016 Capital One Services, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common.h"
+#include "buffer.h"
+#include "columns.h"
+#include "convert.h"
+#include "encoder.h"
+#include "grisu.h"
+#include "record.h"
+
+#include "plan.h"
+
+
+// Handlers returning Python objects (tuple/dict rows)
+#define UNPACK_OP(name, expr) \
+    static PyObject* op_unpack_##name(const TeradataEncoder *e, unsigned char **data, \
+            const GiraffeColumn *column) { \
+        return expr; \
+    }
+
+UNPACK_OP(byteint, teradata_byteint_to_pylong(data))
+UNPACK_OP(smallint, teradata_smallint_to_pylong(data))
+UNPACK_OP(int, teradata_int_to_pylong(data))
+UNPACK_OP(bigint, teradata_bigint_to_pylong(data))
+UNPACK_OP(float, teradata_float_to_pyfloat(data))
+UNPACK_OP(char, teradata_char_to_pystring_f(data, column->Length, column->FormatLength))
+UNPACK_OP(varchar, teradata_varchar_to_pystring(data))
+UNPACK_OP(char_latin1, teradata_char_to_pystring_latin1(data, column->Length, column->FormatLength))
+UNPACK_OP(char_trim, teradata_char_to_pystring_trim(data, column->Length, column->FormatLength))
+UNPACK_OP(char_latin1_trim, teradata_char_to_pystring_latin1_trim(data, column->Length,
+    column->FormatLength))
+UNPACK_OP(varchar_latin1, teradata_varchar_to_pystring_latin1(data))
+UNPACK_OP(byte, teradata_byte_to_pybytes(data, column->Length))
+UNPACK_OP(varbyte, teradata_varbyte_to_pybytes(data))
+UNPACK_OP(default, teradata_char_to_pystring(data, column->Length))
+UNPACK_OP(time_giraffez, teradata_time_to_giraffez_time(data, column->Length))
+UNPACK_OP(ts_giraffez, teradata_ts_to_giraffez_ts(data, column->Length))
+UNPACK_OP(time_py, teradata_time_to_pytime(data, column->Length))
+UNPACK_OP(ts_py, teradata_ts_to_pydatetime(data, column->Length))
+UNPACK_OP(time_epoch, teradata_time_to_epoch(data, column->Length))
+UNPACK_OP(ts_epoch, teradata_ts_to_epoch(data, column->Length))
+
+// Fibonacci hashing spreads the consecutive days of a month (and the
+// gaps between months) over the whole table
+static DateCacheEntry* date_cache_slot(const TeradataEncoder *e, int32_t l) {
+    return &e->DateCache[((uint32_t)l * 2654435761u) >> 22];
+}
+
+static PyObject* date_cache_get(const TeradataEncoder *e, unsigned char **data,
+        PyObject *(*convert)(int32_t)) {
+    DateCacheEntry *entry;
+    PyObject *obj;
+    int32_t l;
+    unpack_int32_t(data, &l);
+    entry = date_cache_slot(e, l);
+    if (entry->value != NULL && entry->key == l) {
+        Py_INCREF(entry->value);
+        return entry->value;
+    }
+    if ((obj = convert(l)) == NULL) {
+        return NULL;
+    }
+    Py_XDECREF(entry->value);
+    Py_INCREF(obj);
+    entry->key = l;
+    entry->value = obj;
+    return obj;
+}
+
+UNPACK_OP(date_str, date_cache_get(e, data, teradata_dateint_to_pystring))
+UNPACK_OP(date_giraffez, date_cache_get(e, data, teradata_dateint_to_giraffez_date))
+UNPACK_OP(date_py, date_cache_get(e, data, teradata_dateint_to_pydate))
+UNPACK_OP(date_epoch, date_cache_get(e, data, teradata_dateint_to_epoch))
+
+// FNV-1a, the keys are short so a byte at a time is fine
+static uint32_t string_cache_hash(const char *s, const uint16_t n) {
+    uint32_t h = 2166136261u;
+    uint16_t i;
+    for (i=0; i<n; i++) {
+        h = (h ^ (unsigned char)s[i]) * 16777619u;
+    }
+    return h;
+}
+
+static void string_cache_free(StringCache *cache) {
+    size_t i;
+    for (i=0; i<STRING_CACHE_SIZE; i++) {
+        Py_XDECREF(cache->entries[i].value);
+    }
+    free(cache);
+}
+
+// Wraps the CHAR/VARCHAR handler of an interned column.  The cache of the
+// column is found through its position in the plan since the handlers
+// only receive the column.
+static PyObject* op_unpack_interned(const TeradataEncoder *e, unsigned char **data,
+        const GiraffeColumn *column) {
+    DecodeOp *op = &e->Plan[column - e->Columns->array];
+    StringCache *cache = op->cache;
+    StringCacheEntry *entry;
+    PyObject *obj;
+    unsigned char *p = *data;
+    uint16_t n;
+    if (column->GDType == GD_VARCHAR) {
+        unpack_uint16_t(&p, &n);
+    } else {
+        n = (uint16_t)column->Length;
+    }
+    if (n > STRING_CACHE_MAX_LENGTH) {
+        return op->base(e, data, column);
+    }
+    entry = &cache->entries[string_cache_hash((char*)p, n) & (STRING_CACHE_SIZE-1)];
+    cache->lookups++;
+    if (entry->value != NULL && entry->length == n && memcmp(entry->data, p, n) == 0) {
+        cache->hits++;
+        *data = p + n;
+        Py_INCREF(entry->value);
+        obj = entry->value;
+    } else {
+        if ((obj = op->base(e, data, column)) == NULL) {
+            return NULL;
+        }
+        Py_XDECREF(entry->value);
+        Py_INCREF(obj);
+        entry->value = obj;
+        entry->length = n;
+        memcpy(entry->data, p, n);
+    }
+    if (cache->lookups == STRING_CACHE_WINDOW) {
+        if (cache->hits < STRING_CACHE_WINDOW / 2) {
+            op->unpack = op->base;
+            op->cache = NULL;
+            string_cache_free(cache);
+        } else {
+            cache->lookups = 0;
+            cache->hits = 0;
+        }
+    }
+    return obj;
+}
+
+// Decimal handlers are specialized for every combination of decimal size
+// and output type, which avoids both the switch on the column length and
+// the indirect call through UnpackDecimalFunc.
+#define UNPACK_DECIMAL_OP(size, out, func) \
+    static PyObject* op_unpack_decimal##size##_##out(const TeradataEncoder *e, unsigned char **data, \
+            const GiraffeColumn *column) { \
+        char buf[BUFFER_ITEM_SIZE]; \
+        int n; \
+        if ((n = teradata_decimal##size##_to_cstring(data, column->Scale, buf)) < 0) { \
+            PyErr_SetString(EncoderError, "Unexpected error while converting decimal"); \
+            return NULL; \
+        } \
+        return func(buf, n); \
+    }
+
+#define UNPACK_DECIMAL_OPS(out, func) \
+    UNPACK_DECIMAL_OP(8, out, func) \
+    UNPACK_DECIMAL_OP(16, out, func) \
+    UNPACK_DECIMAL_OP(32, out, func) \
+    UNPACK_DECIMAL_OP(64, out, func) \
+    UNPACK_DECIMAL_OP(128, out, func) \
+    static PyObject* op_unpack_number_##out(const TeradataEncoder *e, unsigned char **data, \
+            const GiraffeColumn *column) { \
+        char buf[BUFFER_ITEM_SIZE]; \
+        int n; \
+        if ((n = teradata_number_to_cstring(data, buf)) < 0) { \
+            return NULL; \
+        } \
+        return func(buf, n); \
+    }
+
+UNPACK_DECIMAL_OPS(str, cstring_to_pystring)
+
+// Floats and Decimals are converted directly from the binary value
+UNPACK_OP(decimal8_float, teradata_decimal8_to_pyfloat(data, column->Scale))
+UNPACK_OP(decimal16_float, teradata_decimal16_to_pyfloat(data, column->Scale))
+UNPACK_OP(decimal32_float, teradata_decimal32_to_pyfloat(data, column->Scale))
+UNPACK_OP(decimal64_float, teradata_decimal64_to_pyfloat(data, column->Scale))
+UNPACK_OP(decimal128_float, teradata_decimal128_to_pyfloat(data, column->Scale))
+UNPACK_OP(number_float, teradata_number_to_pyfloat(data))
+UNPACK_OP(decimal8_gdecimal, teradata_decimal8_to_giraffez_decimal(data, column->Scale))
+UNPACK_OP(decimal16_gdecimal, teradata_decimal16_to_giraffez_decimal(data, column->Scale))
+UNPACK_OP(decimal32_gdecimal, teradata_decimal32_to_giraffez_decimal(data, column->Scale))
+UNPACK_OP(decimal64_gdecimal, teradata_decimal64_to_giraffez_decimal(data, column->Scale))
+UNPACK_OP(decimal128_gdecimal, teradata_decimal128_to_giraffez_decimal(data, column->Scale))
+UNPACK_OP(number_gdecimal, teradata_number_to_giraffez_decimal(data))
+
+// Scaled integers are the binary value itself
+UNPACK_OP(decimal128_int, teradata_decimal128_to_scaled_pylong(data))
+UNPACK_OP(number_int, teradata_number_to_scaled_pylong(data, column->Scale))
+
+// Indexed by [decimal output][decimal size], the last entry of each row
+// is the NUMBER handler
+static const UnpackItemOp unpack_decimal_ops[4][6] = {
+    {op_unpack_decimal8_str, op_unpack_decimal16_str, op_unpack_decimal32_str,
+        op_unpack_decimal64_str, op_unpack_decimal128_str, op_unpack_number_str},
+    {op_unpack_decimal8_float, op_unpack_decimal16_float, op_unpack_decimal32_float,
+        op_unpack_decimal64_float, op_unpack_decimal128_float, op_unpack_number_float},
+    {op_unpack_decimal8_gdecimal, op_unpack_decimal16_gdecimal, op_unpack_decimal32_gdecimal,
+        op_unpack_decimal64_gdecimal, op_unpack_decimal128_gdecimal, op_unpack_number_gdecimal},
+    {op_unpack_byteint, op_unpack_smallint, op_unpack_int,
+        op_unpack_bigint, op_unpack_decimal128_int, op_unpack_number_int},
+};
+
+// Handlers writing text into the encoder buffer (delimited string rows)
+static int op_write_byteint(const TeradataEncoder *e, unsigned char **data, const GiraffeColumn *column) {
+    int8_t b;
+    char buf[24];
+    unpack_int8_t(data, &b);
+    buffer_write(e->buffer, buf, int64_to_cstring(b, buf));
+    return 0;
+}
+
+static int op_write_smallint(const TeradataEncoder *e, unsigned char **data, const GiraffeColumn *column) {
+    int16_t h;
+    char buf[24];
+    unpack_int16_t(data, &h);
+    buffer_write(e->buffer, buf, int64_to_cstring(h, buf));
+    return 0;
+}
+
+static int op_write_int(const TeradataEncoder *e, unsigned char **data, const GiraffeColumn *column) {
+    int32_t l;
+    char buf[24];
+    unpack_int32_t(data, &l);
+    buffer_write(e->buffer, buf, int64_to_cstring(l, buf));
+    return 0;
+}
+
+static int op_write_bigint(const TeradataEncoder *e, unsigned char **data, const GiraffeColumn *column) {
+    int64_t q;
+    char buf[24];
+    unpack_int64_t(data, &q);
+    buffer_write(e->buffer, buf, int64_to_cstring(q, buf));
+    return 0;
+}
+
+static int op_write_float(const TeradataEncoder *e, unsigned char **data, const GiraffeColumn *column) {
+    double d;
+    char buf[32];
+    unpack_float(data, &d);
+    buffer_write(e->buffer, buf, double_to_cstring(d, buf));
+    return 0;
+}
+
+static int op_write_varchar(const TeradataEncoder *e, unsigned char **data, const GiraffeColumn *column) {
+    uint16_t H;
+    unpack_uint16_t(data, &H);
+    buffer_write(e->buffer, (char*)*data, H);
+    *data += H;
+    return 0;
+}
+
+static int op_write_default(const TeradataEncoder *e, unsigned char **data, const GiraffeColumn *column) {
+    buffer_write(e->buffer, (char*)*data, column->Length);
+    *data += column->Length;
+    return 0;
+}
+
+static int op_write_char_trim(const TeradataEncoder *e, unsigned char **data, const GiraffeColumn *column) {
+    buffer_write(e->buffer, (char*)*data, rtrim_length((char*)*data, column->Length));
+    *data += column->Length;
+    return 0;
+}
+
+static int op_write_date(const TeradataEncoder *e, unsigned char **data, const GiraffeColumn *column) {
+    char buf[BUFFER_ITEM_SIZE];
+    int n;
+    if ((n = teradata_date_to_cstring(data, buf)) < 0) {
+        PyErr_SetString(EncoderError, "Unexpected error while converting date");
+        return -1;
+    }
+    buffer_write(e->buffer, buf, n);
+    return 0;
+}
+
+#define WRITE_DECIMAL_OP(size) \
+    static int op_write_decimal##size(const TeradataEncoder *e, unsigned char **data, \
+            const GiraffeColumn *column) { \
+        char buf[BUFFER_ITEM_SIZE]; \
+        int n; \
+        if ((n = teradata_decimal##size##_to_cstring(data, column->Scale, buf)) < 0) { \
+            PyErr_SetString(EncoderError, "Unexpected error while converting decimal"); \
+            return -1; \
+        } \
+        buffer_write(e->buffer, buf, n); \
+        return 0; \
+    }
+
+WRITE_DECIMAL_OP(8)
+WRITE_DECIMAL_OP(16)
+WRITE_DECIMAL_OP(32)
+WRITE_DECIMAL_OP(64)
+WRITE_DECIMAL_OP(128)
+
+static int op_write_number(const TeradataEncoder *e, unsigned char **data, const GiraffeColumn *column) {
+    char buf[BUFFER_ITEM_SIZE];
+    int n;
+    if ((n = teradata_number_to_cstring(data, buf)) < 0) {
+        return -1;
+    }
+    buffer_write(e->buffer, buf, n);
+    return 0;
+}
+
+static const WriteItemOp write_decimal_ops[6] = {
+    op_write_decimal8, op_write_decimal16, op_write_decimal32, op_write_decimal64, op_write_decimal128, op_write_number
+};
+
+// Decimals that do not have a standard byte length fall back to the
+// generic conversion
+static PyObject* op_unpack_decimal(const TeradataEncoder *e, unsigned char **data,
+        const GiraffeColumn *column) {
+    char buf[BUFFER_ITEM_SIZE];
+    int n;
+    if ((n = teradata_decimal_to_cstring(data, column->Length, column->Scale, buf)) < 0) {
+        PyErr_SetString(EncoderError, "Unexpected error while converting decimal");
+        return NULL;
+    }
+    return e->UnpackDecimalFunc(buf, n);
+}
+
+static int op_write_decimal(const TeradataEncoder *e, unsigned char **data, const GiraffeColumn *column) {
+    char buf[BUFFER_ITEM_SIZE];
+    int n;
+    if ((n = teradata_decimal_to_cstring(data, column->Length, column->Scale, buf)) < 0) {
+        PyErr_SetString(EncoderError, "Unexpected error while converting decimal");
+        return -1;
+    }
+    buffer_write(e->buffer, buf, n);
+    return 0;
+}
+
+// The date format detected for a column is kept in its step of the plan
+static int* pack_date_format(const TeradataEncoder *e, const GiraffeColumn *column) {
+    return &e->PackPlan[column - e->Columns->array].date_format;
+}
+
+// Packers call the generic conversion for anything but the exact builtin
+// type of the column, which returns None on success
+#define PACK_OP(name, expr) \
+    static int op_pack_##name(const TeradataEncoder *e, const GiraffeColumn *column, PyObject *item, \
+            unsigned char **data, uint16_t *length) { \
+        PyObject *result; \
+        if ((result = (expr)) == NULL) { \
+            return -1; \
+        } \
+        Py_DECREF(result); \
+        return 0; \
+    }
+
+PACK_OP(byteint_slow, teradata_byteint_from_pylong(item, column->Length, data, length))
+PACK_OP(smallint_slow, teradata_smallint_from_pylong(item, column->Length, data, length))
+PACK_OP(int_slow, teradata_int_from_pylong(item, column->Length, data, length))
+PACK_OP(bigint_slow, teradata_bigint_from_pylong(item, column->Length, data, length))
+PACK_OP(float_slow, teradata_float_from_pyfloat(item, column->Length, data, length))
+PACK_OP(char_slow, teradata_char_from_pystring(item, column->Length, e->Charset, data, length))
+PACK_OP(varchar_slow, teradata_varchar_from_pystring(item, e->Charset, data, length))
+PACK_OP(decimal, teradata_decimal_from_pystring(item, column->Length, column->Scale, data, length))
+PACK_OP(number, teradata_number_from_pystring(item, data, length))
+PACK_OP(date, teradata_dateint_from_pystring(item, column->Length, pack_date_format(e, column), data, length))
+PACK_OP(time, teradata_time_from_pystring(item, column->Length, data, length))
+PACK_OP(timestamp, teradata_ts_from_pystring(item, column->Length, pack_date_format(e, column), data, length))
+PACK_OP(default, teradata_char_from_pystring(item, column->Length, e->Charset, data, length))
+
+#define PACK_INT_OP(name, type, conv) \
+    static int op_pack_##name(const TeradataEncoder *e, const GiraffeColumn *column, PyObject *item, \
+            unsigned char **data, uint16_t *length) { \
+        PY_LONG_LONG v; \
+        if (!PyLong_CheckExact(item)) { \
+            return op_pack_##name##_slow(e, column, item, data, length); \
+        } \
+        if ((v = conv(item)) == -1 && PyErr_Occurred()) { \
+            return -1; \
+        } \
+        pack_##type(data, (type)v); \
+        *length += column->Length; \
+        return 0; \
+    }
+
+PACK_INT_OP(byteint, int8_t, PyLong_AsLong)
+PACK_INT_OP(smallint, int16_t, PyLong_AsLong)
+PACK_INT_OP(int, int32_t, PyLong_AsLong)
+PACK_INT_OP(bigint, int64_t, PyLong_AsLongLong)
+
+static int op_pack_float(const TeradataEncoder *e, const GiraffeColumn *column, PyObject *item,
+        unsigned char **data, uint16_t *length) {
+    if (!PyFloat_CheckExact(item)) {
+        return op_pack_float_slow(e, column, item, data, length);
+    }
+    pack_float(data, PyFloat_AS_DOUBLE(item));
+    *length += column->Length;
+    return 0;
+}
+
+// ASCII strings are the same bytes in both session charsets
+static int op_pack_char(const TeradataEncoder *e, const GiraffeColumn *column, PyObject *item,
+        unsigned char **data, uint16_t *length) {
+#if PY_MAJOR_VERSION >= 3
+    Py_ssize_t n;
+    if (PyUnicode_CheckExact(item) && PyUnicode_IS_COMPACT_ASCII(item)
+            && (n = PyUnicode_GET_LENGTH(item)) <= (Py_ssize_t)column->Length) {
+        memcpy(*data, PyUnicode_1BYTE_DATA(item), n);
+        memset(*data + n, 0x20, column->Length - n);
+        *data += column->Length;
+        *length += column->Length;
+        return 0;
+    }
+#endif
+    return op_pack_char_slow(e, column, item, data, length);
+}
+
+static int op_pack_varchar(const TeradataEncoder *e, const GiraffeColumn *column, PyObject *item,
+        unsigned char **data, uint16_t *length) {
+#if PY_MAJOR_VERSION >= 3
+    Py_ssize_t n;
+    if (PyUnicode_CheckExact(item) && PyUnicode_IS_COMPACT_ASCII(item)
+            && (n = PyUnicode_GET_LENGTH(item)) <= TD_ROW_MAX_SIZE) {
+        *length += pack_string(data, (char*)PyUnicode_1BYTE_DATA(item), (uint16_t)n);
+        return 0;
+    }
+#endif
+    return op_pack_varchar_slow(e, column, item, data, length);
+}
+
+static PackItemOp pack_op(const GiraffeColumn *column) {
+    switch (column->GDType) {
+        case GD_BYTEINT:
+            return op_pack_byteint;
+        case GD_SMALLINT:
+            return op_pack_smallint;
+        case GD_INTEGER:
+            return op_pack_int;
+        case GD_BIGINT:
+            return op_pack_bigint;
+        case GD_FLOAT:
+            return op_pack_float;
+        case GD_DECIMAL:
+            return op_pack_decimal;
+        case GD_CHAR:
+            return op_pack_char;
+        case GD_VARCHAR:
+            return op_pack_varchar;
+        case GD_DATE:
+            return op_pack_date;
+        case GD_TIME:
+            // values WITH TIME ZONE are packed as the text they are given
+            return column_has_time_zone(column) ? op_pack_char : op_pack_time;
+        case GD_TIMESTAMP:
+            return column_has_time_zone(column) ? op_pack_char : op_pack_timestamp;
+        case GD_NUMBER:
+            return op_pack_number;
+    }
+    return op_pack_default;
+}
+
+static int decimal_op_index(const GiraffeColumn *column) {
+    if (column->GDType == GD_NUMBER) {
+        return 5;
+    }
+    switch (column->Length) {
+        case DECIMAL8:
+            return 0;
+        case DECIMAL16:
+            return 1;
+        case DECIMAL32:
+            return 2;
+        case DECIMAL64:
+            return 3;
+        case DECIMAL128:
+            return 4;
+    }
+    return -1;
+}
+
+static int decimal_output_index(const uint32_t settings) {
+    switch (settings & DECIMAL_RETURN_MASK) {
+        case DECIMAL_AS_STRING:
+            return 0;
+        case DECIMAL_AS_FLOAT:
+            return 1;
+        case DECIMAL_AS_GIRAFFEZ_DECIMAL:
+            return 2;
+        case DECIMAL_AS_SCALED_INT:
+            return 3;
+    }
+    return -1;
+}
+
+static void decode_plan_free(DecodeOp *plan) {
+    DecodeOp *op;
+    if (plan == NULL) {
+        return;
+    }
+    // The plan ends with an empty op since the columns it was compiled
+    // for may already have been replaced
+    for (op=plan; op->unpack != NULL; op++) {
+        if (op->cache != NULL) {
+            string_cache_free(op->cache);
+        }
+        Py_XDECREF(op->key);
+    }
+    free(plan);
+}
+
+static void pack_plan_free(EncodeOp *plan) {
+    EncodeOp *op;
+    if (plan == NULL) {
+        return;
+    }
+    for (op=plan; op->pack != NULL; op++) {
+        Py_XDECREF(op->key);
+    }
+    free(plan);
+}
+
+static void date_cache_free(DateCacheEntry *cache) {
+    size_t i;
+    if (cache == NULL) {
+        return;
+    }
+    for (i=0; i<DATE_CACHE_SIZE; i++) {
+        Py_XDECREF(cache[i].value);
+    }
+    free(cache);
+}
+
+// The plan is compiled next to the current one and only replaces it once
+// complete, so a failure leaves the encoder as it was.  A current plan
+// always belongs to the same columns (encoder_set_columns releases it
+// first), so its caches are moved to the new plan when the settings
+// still produce the same objects.
+int plan_compile(TeradataEncoder *e) {
+    GiraffeColumn *column;
+    DecodeOp *plan = NULL, *op, *previous = e->Plan;
+    EncodeOp *pack_plan = NULL;
+    DateCacheEntry *date_cache = NULL;
+    PyObject *row_type = NULL;
+    size_t i, offset;
+    int d, o, fixed = 1, has_date = 0, keep_dates, keep_strings;
+    if (e->Columns == NULL) {
+        plan_free(e);
+        return 0;
+    }
+    keep_dates = e->DateCache != NULL
+        && (e->PlanSettings & DATETIME_RETURN_MASK) == (e->Settings & DATETIME_RETURN_MASK);
+    keep_strings = previous != NULL && e->PlanCharset == e->Charset
+        && (e->PlanSettings & STRING_RETURN_MASK) == (e->Settings & STRING_RETURN_MASK);
+    if ((plan = (DecodeOp*)calloc(e->Columns->length+1, sizeof(DecodeOp))) == NULL) {
+        goto error;
+    }
+    if ((pack_plan = (EncodeOp*)calloc(e->Columns->length+1, sizeof(EncodeOp))) == NULL) {
+        goto error;
+    }
+    o = decimal_output_index(e->Settings);
+    offset = e->Columns->header_length;
+    for (i=0; i<e->Columns->length; i++) {
+        if (e->Columns->array[i].GDType == GD_DATE) {
+            has_date = 1;
+            break;
+        }
+    }
+    if (has_date && !keep_dates
+            && (date_cache = (DateCacheEntry*)calloc(DATE_CACHE_SIZE, sizeof(DateCacheEntry))) == NULL) {
+        goto error;
+    }
+    for (i=0; i<e->Columns->length; i++) {
+        column = &e->Columns->array[i];
+        op = &plan[i];
+        op->offset = offset;
+        op->cache = NULL;
+        offset += column->NullLength;
+        if (column->GDType == GD_VARCHAR || column->GDType == GD_VARBYTE
+                || column->GDType == GD_NUMBER) {
+            fixed = 0;
+        }
+        switch (column->GDType) {
+            case GD_BYTEINT:
+                op->unpack = op_unpack_byteint;
+                op->write = op_write_byteint;
+                break;
+            case GD_SMALLINT:
+                op->unpack = op_unpack_smallint;
+                op->write = op_write_smallint;
+                break;
+            case GD_INTEGER:
+                op->unpack = op_unpack_int;
+                op->write = op_write_int;
+                break;
+            case GD_BIGINT:
+                op->unpack = op_unpack_bigint;
+                op->write = op_write_bigint;
+                break;
+            case GD_FLOAT:
+                op->unpack = op_unpack_float;
+                op->write = op_write_float;
+                break;
+            case GD_DECIMAL:
+            case GD_NUMBER:
+                if ((d = decimal_op_index(column)) < 0 || o < 0) {
+                    op->unpack = op_unpack_decimal;
+                    op->write = op_write_decimal;
+                } else {
+                    op->unpack = unpack_decimal_ops[o][d];
+                    op->write = write_decimal_ops[d];
+                }
+                break;
+            case GD_CHAR:
+                if (e->Settings & STRING_TRIM_CHAR) {
+                    op->unpack = e->Charset == CHARSET_LATIN1 ? op_unpack_char_latin1_trim : op_unpack_char_trim;
+                    op->write = op_write_char_trim;
+                } else {
+                    op->unpack = e->Charset == CHARSET_LATIN1 ? op_unpack_char_latin1 : op_unpack_char;
+                    op->write = op_write_default;
+                }
+                break;
+            case GD_VARCHAR:
+                op->unpack = e->Charset == CHARSET_LATIN1 ? op_unpack_varchar_latin1 : op_unpack_varchar;
+                op->write = op_write_varchar;
+                break;
+            case GD_DATE:
+                switch (e->Settings & DATETIME_RETURN_MASK) {
+                    case DATETIME_AS_GIRAFFE_TYPES:
+                        op->unpack = op_unpack_date_giraffez;
+                        break;
+                    case DATETIME_AS_PYDATETIME:
+                        op->unpack = op_unpack_date_py;
+                        break;
+                    case DATETIME_AS_EPOCH:
+                        op->unpack = op_unpack_date_epoch;
+                        break;
+                    default:
+                        op->unpack = op_unpack_date_str;
+                }
+                op->write = op_write_date;
+                break;
+            case GD_TIME:
+                switch (e->Settings & DATETIME_RETURN_MASK) {
+                    case DATETIME_AS_GIRAFFE_TYPES:
+                        op->unpack = column_has_time_zone(column) ? op_unpack_default : op_unpack_time_giraffez;
+                        break;
+                    case DATETIME_AS_PYDATETIME:
+                        op->unpack = column_has_time_zone(column) ? op_unpack_default : op_unpack_time_py;
+                        break;
+                    case DATETIME_AS_EPOCH:
+                        op->unpack = op_unpack_time_epoch;
+                        break;
+                    default:
+                        op->unpack = op_unpack_default;
+                }
+                op->write = op_write_default;
+                break;
+            case GD_TIMESTAMP:
+                switch (e->Settings & DATETIME_RETURN_MASK) {
+                    case DATETIME_AS_GIRAFFE_TYPES:
+                        op->unpack = column_has_time_zone(column) ? op_unpack_default : op_unpack_ts_giraffez;
+                        break;
+                    case DATETIME_AS_PYDATETIME:
+                        op->unpack = column_has_time_zone(column) ? op_unpack_default : op_unpack_ts_py;
+                        break;
+                    case DATETIME_AS_EPOCH:
+                        op->unpack = op_unpack_ts_epoch;
+                        break;
+                    default:
+                        op->unpack = op_unpack_default;
+                }
+                op->write = op_write_default;
+                break;
+            case GD_BYTE:
+                op->unpack = op_unpack_byte;
+                op->write = op_write_default;
+                break;
+            case GD_VARBYTE:
+                op->unpack = op_unpack_varbyte;
+                op->write = op_write_varchar;
+                break;
+            default:
+                op->unpack = op_unpack_default;
+                op->write = op_write_default;
+        }
+        op->base = op->unpack;
+        if ((e->Settings & STRING_RETURN_MASK & ~STRING_TRIM_CHAR) == STRING_AS_INTERNED
+                && (column->GDType == GD_CHAR || column->GDType == GD_VARCHAR)) {
+            // a cache that was released for missing too often stays released
+            if (keep_strings) {
+                op->cache = previous[i].cache;
+            } else if ((op->cache = (StringCache*)calloc(1, sizeof(StringCache))) == NULL) {
+                goto error;
+            }
+            if (op->cache != NULL) {
+                op->unpack = op_unpack_interned;
+            }
+        }
+        if ((e->Settings & ROW_RETURN_MASK) == ROW_ENCODING_DICT
+                && (op->key = PyUnicode_InternFromString(column->Title)) == NULL) {
+            goto error;
+        }
+        pack_plan[i].pack = pack_op(column);
+        if (e->PackPlan != NULL) {
+            pack_plan[i].date_format = e->PackPlan[i].date_format;
+        }
+        if ((e->Settings & ROW_RETURN_MASK) == ROW_ENCODING_DICT
+                && (pack_plan[i].key = PyUnicode_InternFromString(column->Name)) == NULL) {
+            goto error;
+        }
+    }
+    if ((e->Settings & ROW_RETURN_MASK) == ROW_ENCODING_RECORD
+            && (row_type = record_type_new(e->Columns, &RecordType)) == NULL) {
+        goto error;
+    }
+    if ((e->Settings & ROW_RETURN_MASK) == ROW_ENCODING_LAZY
+            && (row_type = record_type_new(e->Columns, &LazyRecordType)) == NULL) {
+        goto error;
+    }
+    // the caches moved to the new plan are detached from the current one
+    // before it is released
+    if (keep_strings) {
+        for (op=previous; op->unpack != NULL; op++) {
+            op->cache = NULL;
+        }
+    }
+    if (keep_dates) {
+        date_cache = e->DateCache;
+        e->DateCache = NULL;
+    }
+    plan_free(e);
+    e->Plan = plan;
+    e->PackPlan = pack_plan;
+    e->DateCache = date_cache;
+    e->RowType = row_type;
+    e->PlanSettings = e->Settings;
+    e->PlanCharset = e->Charset;
+    if (fixed && offset <= TD_ROW_MAX_SIZE) {
+        e->FixedRowLength = (uint32_t)offset;
+    }
+    return 0;
+error:
+    if (keep_strings && plan != NULL) {
+        for (op=plan; op->unpack != NULL; op++) {
+            op->cache = NULL;
+        }
+    }
+    decode_plan_free(plan);
+    pack_plan_free(pack_plan);
+    date_cache_free(date_cache);
+    Py_XDECREF(row_type);
+    return -1;
+}
+
+void plan_free(TeradataEncoder *e) {
+    decode_plan_free(e->Plan);
+    e->Plan = NULL;
+    pack_plan_free(e->PackPlan);
+    e->PackPlan = NULL;
+    date_cache_free(e->DateCache);
+    e->DateCache = NULL;
+    Py_CLEAR(e->RowType);
+    e->FixedRowLength = 0;
+    e->Generation++;
+}
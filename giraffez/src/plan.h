@@ -0,0 +1,65 @@
+/*
+ * Copyright 2016 Capital One Services, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GIRAFFEZ_PLAN_H
+#define __GIRAFFEZ_PLAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+#include "columns.h"
+#include "encoder.h"
+
+
+// The decode plan is compiled once per set of columns and encoder
+// settings, resolving the GDType and output setting of every column to a
+// specialized handler ahead of time so that the row loops in row.c only
+// have to walk the plan.
+//
+// When none of the columns are variable-length (VARCHAR, VARBYTE and
+// NUMBER) every row has the same layout, so the byte offset of each
+// column is also recorded and FixedRowLength is set, allowing rows and
+// values to be located without walking the buffer.
+//
+// Extracts usually hit a small working set of distinct dates, so DATE
+// columns decoded into Python objects go through a per-encoder cache
+// (DateCache) holding the last object built for each raw value.  A hit
+// returns a new reference to the cached str or giraffez.Date instead of
+// building another one, so repeated dates share a single object.  The
+// cache is emptied when the columns or the DATETIME setting change.
+//
+// With STRING_AS_INTERNED, CHAR and VARCHAR columns get the same kind of
+// cache keyed on the raw bytes (up to STRING_CACHE_MAX_LENGTH), meant for
+// low-cardinality columns like status and country codes.  The hit rate is
+// checked every STRING_CACHE_WINDOW lookups and the cache of a column that
+// hits less than half of the time is released, restoring the uncached
+// handler for the rest of the plan's life.  These caches are kept while
+// the columns, charset and STRING setting stay the same.
+//
+// Rows are packed through a second plan (PackPlan) compiled at the same
+// time, holding the packer of every column.  The packers take the exact
+// builtin type expected for the column (int, float, ASCII str) directly
+// and hand anything else to the generic conversions in convert.c.
+int  plan_compile(TeradataEncoder *e);
+void plan_free(TeradataEncoder *e);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
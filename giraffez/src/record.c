@@ -0,0 +1,586 @@
+/*
+ * Copyright 2016 Capital One Services, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common.h"
+#include "columns.h"
+#include "convert.h"
+#include "encoder.h"
+
+#include "record.h"
+
+
+static int record_index_set(PyObject *index, const char *name, PyObject *pos) {
+    PyObject *key;
+    int r;
+    if (name == NULL || strlen(name) == 0) {
+        return 0;
+    }
+    if ((key = PyUnicode_FromString(name)) == NULL) {
+        return -1;
+    }
+    r = PyDict_SetItem(index, key, pos);
+    Py_DECREF(key);
+    return r;
+}
+
+// The name of a type without its module
+static const char* type_short_name(PyTypeObject *type) {
+    const char *name = strrchr(type->tp_name, '.');
+    return name != NULL ? name + 1 : type->tp_name;
+}
+
+// The index is built the same way as giraffez.Columns, a later column
+// takes over a name already used by an earlier one (i.e. joins).
+PyObject* record_type_new(const GiraffeColumns *columns, PyTypeObject *base) {
+    PyObject *names = NULL, *index = NULL, *dict = NULL, *type = NULL;
+    PyObject *name, *pos;
+    GiraffeColumn *column;
+    char *alias;
+    size_t i;
+    int r;
+    if ((names = PyTuple_New(columns->length)) == NULL || (index = PyDict_New()) == NULL) {
+        goto error;
+    }
+    for (i=0; i<columns->length; i++) {
+        column = &columns->array[i];
+        name = PyUnicode_FromString(column->Title != NULL ? column->Title : column->SafeName);
+        if (name == NULL) {
+            goto error;
+        }
+        PyTuple_SET_ITEM(names, i, name);
+        if ((pos = PyLong_FromSize_t(i)) == NULL) {
+            goto error;
+        }
+        r = record_index_set(index, column->SafeName, pos);
+        if (r == 0 && column->Alias != NULL && strlen(column->Alias) > 0) {
+            alias = safe_name(column->Alias);
+            r = record_index_set(index, alias, pos);
+            free(alias);
+        }
+        if (r == 0) {
+            r = PyDict_SetItem(index, name, pos);
+        }
+        Py_DECREF(pos);
+        if (r != 0) {
+            goto error;
+        }
+    }
+    if ((dict = Py_BuildValue("{s:(),s:O,s:O,s:s}", "__slots__", "_fields", names, "_index", index,
+            "__module__", "giraffez._teradata")) == NULL) {
+        goto error;
+    }
+    // the subclass is named after its base so that repr and the type
+    // name point at a type that can be imported
+    type = PyObject_CallFunction((PyObject*)&PyType_Type, "s(O)O", type_short_name(base), (PyObject*)base, dict);
+error:
+    Py_XDECREF(names);
+    Py_XDECREF(index);
+    Py_XDECREF(dict);
+    return type;
+}
+
+PyObject* teradata_row_to_pyrecord(const TeradataEncoder *e, unsigned char **data, const uint16_t length) {
+    PyTypeObject *type = (PyTypeObject*)e->RowType;
+    PyObject *item;
+    Record *row;
+    GiraffeColumn *column;
+    size_t i;
+    int nulls;
+    if (type == NULL) {
+        PyErr_SetString(EncoderError, "Encoder has no columns to create records with");
+        return NULL;
+    }
+    if ((row = (Record*)type->tp_alloc(type, e->Columns->length)) == NULL) {
+        return NULL;
+    }
+    nulls = indicator_set(e->Columns, data);
+    for (i=0; i<e->Columns->length; i++) {
+        column = &e->Columns->array[i];
+        if (nulls && indicator_read(e->Columns->buffer, i)) {
+            *data += column->NullLength;
+            Py_INCREF(e->NullValue);
+            row->items[i] = e->NullValue;
+            continue;
+        }
+        if ((item = e->Plan[i].unpack(e, data, column)) == NULL) {
+            Py_DECREF(row);
+            return NULL;
+        }
+        row->items[i] = item;
+    }
+    return (PyObject*)row;
+}
+
+// Records where each cell of the row starts, without decoding any of
+// them.  Null cells keep the offset 0 (the indicator header).
+static PyObject* lazy_record_new(const TeradataEncoder *e, PyObject *bytes, unsigned char *row,
+        const uint16_t length) {
+    PyTypeObject *type = (PyTypeObject*)e->RowType;
+    GiraffeColumn *column;
+    LazyRecord *r;
+    unsigned char *p;
+    uint16_t H;
+    size_t i, n;
+    if (type == NULL) {
+        PyErr_SetString(EncoderError, "Encoder has no columns to create records with");
+        return NULL;
+    }
+    if (e->Owner == NULL) {
+        PyErr_SetString(EncoderError, "Lazy rows are not supported by this encoder");
+        return NULL;
+    }
+    n = e->Columns->length;
+    if ((r = (LazyRecord*)type->tp_alloc(type, n)) == NULL) {
+        return NULL;
+    }
+    Py_INCREF(bytes);
+    r->data = bytes;
+    Py_INCREF(e->Owner);
+    r->owner = e->Owner;
+    r->encoder = e;
+    r->generation = e->Generation;
+    r->row = row;
+    r->offsets = (uint16_t*)&r->items[n];
+    if (e->FixedRowLength > 0 && length != e->FixedRowLength) {
+        PyErr_Format(EncoderError, "Row length %u does not match the fixed row length %u of the columns",
+            length, e->FixedRowLength);
+        Py_DECREF(r);
+        return NULL;
+    }
+    p = row + e->Columns->header_length;
+    for (i=0; i<n; i++) {
+        column = &e->Columns->array[i];
+        if (indicator_read(row, i)) {
+            r->offsets[i] = 0;
+            p += column->NullLength;
+            continue;
+        }
+        if (e->FixedRowLength > 0) {
+            r->offsets[i] = (uint16_t)e->Plan[i].offset;
+            continue;
+        }
+        r->offsets[i] = (uint16_t)(p - row);
+        switch (column->GDType) {
+            case GD_VARCHAR:
+            case GD_VARBYTE:
+                if (p + sizeof(H) > row + length) {
+                    goto error;
+                }
+                memcpy(&H, p, sizeof(H));
+                p += sizeof(H) + H;
+                break;
+            case GD_NUMBER:
+                if (p >= row + length) {
+                    goto error;
+                }
+                p += 1 + *p;
+                break;
+            default:
+                p += column->Length;
+        }
+    }
+    if (p > row + length) {
+        goto error;
+    }
+    return (PyObject*)r;
+error:
+    PyErr_SetString(EncoderError, "Row length does not match the length of its columns");
+    Py_DECREF(r);
+    return NULL;
+}
+
+PyObject* teradata_row_to_pylazy(const TeradataEncoder *e, unsigned char **data, const uint16_t length) {
+    PyObject *bytes, *row;
+    if ((bytes = PyBytes_FromStringAndSize((char*)*data, length)) == NULL) {
+        return NULL;
+    }
+    row = lazy_record_new(e, bytes, (unsigned char*)PyBytes_AS_STRING(bytes), length);
+    Py_DECREF(bytes);
+    *data += length;
+    return row;
+}
+
+// The buffer is copied once and shared by all of its rows
+PyObject* teradata_buffer_to_pylazy(const TeradataEncoder *e, unsigned char **data, const uint32_t length) {
+    PyObject *bytes, *rows, *row;
+    unsigned char *p, *end;
+    uint16_t row_length;
+    if ((bytes = PyBytes_FromStringAndSize((char*)*data, length)) == NULL) {
+        return NULL;
+    }
+    if ((rows = PyList_New(0)) == NULL) {
+        Py_DECREF(bytes);
+        return NULL;
+    }
+    p = (unsigned char*)PyBytes_AS_STRING(bytes);
+    end = p + length;
+    while (p + sizeof(uint16_t) <= end) {
+        unpack_uint16_t(&p, &row_length);
+        if (p + row_length > end) {
+            PyErr_SetString(EncoderError, "Row length exceeds the end of the buffer");
+            goto error;
+        }
+        if ((row = lazy_record_new(e, bytes, p, row_length)) == NULL) {
+            goto error;
+        }
+        p += row_length;
+        if (PyList_Append(rows, row) != 0) {
+            Py_DECREF(row);
+            goto error;
+        }
+        Py_DECREF(row);
+    }
+    Py_DECREF(bytes);
+    *data += length;
+    return rows;
+error:
+    Py_DECREF(bytes);
+    Py_DECREF(rows);
+    return NULL;
+}
+
+// The positions of the column names are kept in the dict of the
+// per-schema subclass, the base types have none.  The methods shared
+// by Record and LazyRecord get their values through Row_item.
+static PyObject* Row_index(PyObject *self) {
+    PyObject *dict = Py_TYPE(self)->tp_dict;
+    return dict != NULL ? PyDict_GetItemString(dict, "_index") : NULL;
+}
+
+static PyObject* Row_fields(PyObject *self) {
+    PyObject *dict = Py_TYPE(self)->tp_dict;
+    return dict != NULL ? PyDict_GetItemString(dict, "_fields") : NULL;
+}
+
+static PyObject* Record_item(Record *self, Py_ssize_t i);
+static PyObject* LazyRecord_item(LazyRecord *self, Py_ssize_t i);
+
+// The slots of the per-schema subclasses are wrappers calling back into
+// the mapping methods, so the base type's item function is used directly
+static PyObject* Row_item(PyObject *self, Py_ssize_t i) {
+    if (PyObject_TypeCheck(self, &LazyRecordType)) {
+        return LazyRecord_item((LazyRecord*)self, i);
+    }
+    return Record_item((Record*)self, i);
+}
+
+static Py_ssize_t Row_length(PyObject *self) {
+    return Py_SIZE(self);
+}
+
+static PyObject* Row_as_tuple(PyObject *self) {
+    PyObject *t, *item;
+    Py_ssize_t i;
+    if ((t = PyTuple_New(Py_SIZE(self))) == NULL) {
+        return NULL;
+    }
+    for (i=0; i<Py_SIZE(self); i++) {
+        if ((item = Row_item(self, i)) == NULL) {
+            Py_DECREF(t);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(t, i, item);
+    }
+    return t;
+}
+
+static PyObject* Row_subscript(PyObject *self, PyObject *key) {
+    PyObject *index, *pos, *t, *item;
+    Py_ssize_t i;
+    if (PyStr_Check(key)) {
+        // AttributeError is kept from the giraffez.Row this replaces
+        if ((index = Row_index(self)) == NULL || (pos = PyDict_GetItem(index, key)) == NULL) {
+            if ((t = PyUnicode_FromFormat("Row has no column '%S'", key)) != NULL) {
+                PyErr_SetObject(PyExc_AttributeError, t);
+                Py_DECREF(t);
+            }
+            return NULL;
+        }
+        return Row_item(self, PyLong_AsSsize_t(pos));
+    }
+    if (PyIndex_Check(key)) {
+        if ((i = PyNumber_AsSsize_t(key, PyExc_IndexError)) == -1 && PyErr_Occurred()) {
+            return NULL;
+        }
+        if (i < 0) {
+            i += Py_SIZE(self);
+        }
+        return Row_item(self, i);
+    }
+    // Slices return plain tuples
+    if ((t = Row_as_tuple(self)) == NULL) {
+        return NULL;
+    }
+    item = PyObject_GetItem(t, key);
+    Py_DECREF(t);
+    return item;
+}
+
+// Attributes of the type (items, __json__, ...) are looked up before the
+// column names, so a column named like a method does not hide it
+static PyObject* Row_getattro(PyObject *self, PyObject *name) {
+    PyObject *index, *pos;
+    if (_PyType_Lookup(Py_TYPE(self), name) == NULL && (index = Row_index(self)) != NULL
+            && (pos = PyDict_GetItem(index, name)) != NULL) {
+        return Row_item(self, PyLong_AsSsize_t(pos));
+    }
+    return PyObject_GenericGetAttr(self, name);
+}
+
+static PyObject* Row_iter(PyObject *self) {
+    return PySeqIter_New(self);
+}
+
+static PyObject* Row_items(PyObject *self) {
+    PyObject *fields, *d, *item;
+    Py_ssize_t i;
+    if ((d = PyDict_New()) == NULL) {
+        return NULL;
+    }
+    if ((fields = Row_fields(self)) == NULL) {
+        return d;
+    }
+    for (i=0; i<Py_SIZE(self) && i<PyTuple_GET_SIZE(fields); i++) {
+        if ((item = Row_item(self, i)) == NULL || PyDict_SetItem(d, PyTuple_GET_ITEM(fields, i), item) != 0) {
+            Py_XDECREF(item);
+            Py_DECREF(d);
+            return NULL;
+        }
+        Py_DECREF(item);
+    }
+    return d;
+}
+
+static PyObject* Row_repr(PyObject *self) {
+    PyObject *items, *s;
+    if ((items = Row_items(self)) == NULL) {
+        return NULL;
+    }
+    s = PyUnicode_FromFormat("%s(%R)", type_short_name(Py_TYPE(self)), items);
+    Py_DECREF(items);
+    return s;
+}
+
+static PyObject* Row_str(PyObject *self) {
+    PyObject *items, *s;
+    if ((items = Row_items(self)) == NULL) {
+        return NULL;
+    }
+    s = PyObject_Str(items);
+    Py_DECREF(items);
+    return s;
+}
+
+static PyMappingMethods Row_as_mapping = {
+    (lenfunc)Row_length,                            /* mp_length */
+    (binaryfunc)Row_subscript,                      /* mp_subscript */
+    0,                                              /* mp_ass_subscript */
+};
+
+static PyMethodDef Row_methods[] = {
+    {"items", (PyCFunction)Row_items, METH_NOARGS, ""},
+    {"__json__", (PyCFunction)Row_items, METH_NOARGS, ""},
+    {NULL}  /* Sentinel */
+};
+
+static void Record_dealloc(Record *self) {
+    Py_ssize_t i;
+    PyObject_GC_UnTrack(self);
+    for (i=0; i<Py_SIZE(self); i++) {
+        Py_XDECREF(self->items[i]);
+    }
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int Record_traverse(Record *self, visitproc visit, void *arg) {
+    Py_ssize_t i;
+    for (i=0; i<Py_SIZE(self); i++) {
+        Py_VISIT(self->items[i]);
+    }
+    return 0;
+}
+
+static int Record_clear(Record *self) {
+    Py_ssize_t i;
+    for (i=0; i<Py_SIZE(self); i++) {
+        Py_CLEAR(self->items[i]);
+    }
+    return 0;
+}
+
+static PyObject* Record_item(Record *self, Py_ssize_t i) {
+    if (i < 0 || i >= Py_SIZE(self) || self->items[i] == NULL) {
+        PyErr_SetString(PyExc_IndexError, "row index out of range");
+        return NULL;
+    }
+    Py_INCREF(self->items[i]);
+    return self->items[i];
+}
+
+static PySequenceMethods Record_as_sequence = {
+    (lenfunc)Row_length,                            /* sq_length */
+    0,                                              /* sq_concat */
+    0,                                              /* sq_repeat */
+    (ssizeargfunc)Record_item,                      /* sq_item */
+};
+
+PyTypeObject RecordType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "giraffez._teradata.Record",                    /* tp_name */
+    sizeof(Record) - sizeof(PyObject*),             /* tp_basicsize */
+    sizeof(PyObject*),                              /* tp_itemsize */
+    (destructor)Record_dealloc,                     /* tp_dealloc */
+    0,                                              /* tp_print */
+    0,                                              /* tp_getattr */
+    0,                                              /* tp_setattr */
+    0,                                              /* tp_compare */
+    (reprfunc)Row_repr,                             /* tp_repr */
+    0,                                              /* tp_as_number */
+    &Record_as_sequence,                            /* tp_as_sequence */
+    &Row_as_mapping,                                /* tp_as_mapping */
+    0,                                              /* tp_hash */
+    0,                                              /* tp_call */
+    (reprfunc)Row_str,                              /* tp_str */
+    (getattrofunc)Row_getattro,                     /* tp_getattro */
+    0,                                              /* tp_setattro */
+    0,                                              /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC, /* tp_flags */
+    "Record objects",                               /* tp_doc */
+    (traverseproc)Record_traverse,                  /* tp_traverse */
+    (inquiry)Record_clear,                          /* tp_clear */
+    0,                                              /* tp_richcompare */
+    0,                                              /* tp_weaklistoffset */
+    (getiterfunc)Row_iter,                          /* tp_iter */
+    0,                                              /* tp_iternext */
+    Row_methods,                                    /* tp_methods */
+    0,                                              /* tp_members */
+    0,                                              /* tp_getset */
+    0,                                              /* tp_base */
+    0,                                              /* tp_dict */
+    0,                                              /* tp_descr_get */
+    0,                                              /* tp_descr_set */
+    0,                                              /* tp_dictoffset */
+    0,                                              /* tp_init */
+    0,                                              /* tp_alloc */
+    0,                                              /* tp_new */
+};
+
+static void LazyRecord_dealloc(LazyRecord *self) {
+    Py_ssize_t i;
+    PyObject_GC_UnTrack(self);
+    for (i=0; i<Py_SIZE(self); i++) {
+        Py_XDECREF(self->items[i]);
+    }
+    Py_XDECREF(self->data);
+    Py_XDECREF(self->owner);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int LazyRecord_traverse(LazyRecord *self, visitproc visit, void *arg) {
+    Py_ssize_t i;
+    for (i=0; i<Py_SIZE(self); i++) {
+        Py_VISIT(self->items[i]);
+    }
+    Py_VISIT(self->owner);
+    return 0;
+}
+
+static int LazyRecord_clear(LazyRecord *self) {
+    Py_ssize_t i;
+    for (i=0; i<Py_SIZE(self); i++) {
+        Py_CLEAR(self->items[i]);
+    }
+    return 0;
+}
+
+// Cells are decoded with the plan of the encoder on first access and
+// kept, which is only valid while the encoder still has the columns
+// and settings the row was read with.
+static PyObject* LazyRecord_item(LazyRecord *self, Py_ssize_t i) {
+    const TeradataEncoder *e = self->encoder;
+    unsigned char *p;
+    PyObject *item;
+    if (i < 0 || i >= Py_SIZE(self)) {
+        PyErr_SetString(PyExc_IndexError, "row index out of range");
+        return NULL;
+    }
+    if (self->items[i] == NULL) {
+        if (e->Generation != self->generation) {
+            PyErr_SetString(EncoderError, "Columns or settings of the encoder changed since the row was read");
+            return NULL;
+        }
+        if (self->offsets[i] == 0) {
+            Py_INCREF(e->NullValue);
+            item = e->NullValue;
+        } else {
+            p = self->row + self->offsets[i];
+            if ((item = e->Plan[i].unpack(e, &p, &e->Columns->array[i])) == NULL) {
+                return NULL;
+            }
+        }
+        self->items[i] = item;
+    }
+    Py_INCREF(self->items[i]);
+    return self->items[i];
+}
+
+static PySequenceMethods LazyRecord_as_sequence = {
+    (lenfunc)Row_length,                            /* sq_length */
+    0,                                              /* sq_concat */
+    0,                                              /* sq_repeat */
+    (ssizeargfunc)LazyRecord_item,                  /* sq_item */
+};
+
+PyTypeObject LazyRecordType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "giraffez._teradata.LazyRecord",                /* tp_name */
+    sizeof(LazyRecord) - sizeof(PyObject*),         /* tp_basicsize */
+    sizeof(PyObject*) + sizeof(uint16_t),           /* tp_itemsize */
+    (destructor)LazyRecord_dealloc,                 /* tp_dealloc */
+    0,                                              /* tp_print */
+    0,                                              /* tp_getattr */
+    0,                                              /* tp_setattr */
+    0,                                              /* tp_compare */
+    (reprfunc)Row_repr,                             /* tp_repr */
+    0,                                              /* tp_as_number */
+    &LazyRecord_as_sequence,                        /* tp_as_sequence */
+    &Row_as_mapping,                                /* tp_as_mapping */
+    0,                                              /* tp_hash */
+    0,                                              /* tp_call */
+    (reprfunc)Row_str,                              /* tp_str */
+    (getattrofunc)Row_getattro,                     /* tp_getattro */
+    0,                                              /* tp_setattro */
+    0,                                              /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC, /* tp_flags */
+    "LazyRecord objects",                           /* tp_doc */
+    (traverseproc)LazyRecord_traverse,              /* tp_traverse */
+    (inquiry)LazyRecord_clear,                      /* tp_clear */
+    0,                                              /* tp_richcompare */
+    0,                                              /* tp_weaklistoffset */
+    (getiterfunc)Row_iter,                          /* tp_iter */
+    0,                                              /* tp_iternext */
+    Row_methods,                                    /* tp_methods */
+    0,                                              /* tp_members */
+    0,                                              /* tp_getset */
+    0,                                              /* tp_base */
+    0,                                              /* tp_dict */
+    0,                                              /* tp_descr_get */
+    0,                                              /* tp_descr_set */
+    0,                                              /* tp_dictoffset */
+    0,                                              /* tp_init */
+    0,                                              /* tp_alloc */
+    0,                                              /* tp_new */
+};
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2016 Capital One Services, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GIRAFFEZ_RECORD_H
+#define __GIRAFFEZ_RECORD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+#include "columns.h"
+#include "encoder.h"
+
+
+// Record is the row type of ROW_ENCODING_RECORD.  Values are stored
+// inline like a tuple, so a row costs the same as ROW_ENCODING_LIST,
+// while still supporting the access patterns of giraffez.Row: by index,
+// by column name (row["name"]) and as attributes (row.name).
+//
+// A subclass named Row is created for every set of columns (see
+// record_type_new) holding the column names in _fields and the position
+// of every column name and title in _index.  Column names take
+// precedence over the methods of the type when accessed as attributes.
+typedef struct {
+    PyObject_VAR_HEAD
+    PyObject *items[1];
+} Record;
+
+// LazyRecord is the row type of ROW_ENCODING_LAZY, with the same access
+// patterns as Record.  Rows keep a reference to a copy of the buffer
+// they were read from (shared by all rows of a buffer) and the offset
+// of each cell, which is only decoded when it is first accessed.  The
+// offsets are stored after the items, in the same allocation.
+typedef struct {
+    PyObject_VAR_HEAD
+    PyObject              *data;
+    PyObject              *owner;
+    const TeradataEncoder *encoder;
+    uint32_t              generation;
+    unsigned char         *row;
+    uint16_t              *offsets;
+    PyObject              *items[1];
+} LazyRecord;
+
+PyObject* record_type_new(const GiraffeColumns *columns, PyTypeObject *base);
+
+PyObject* teradata_row_to_pyrecord(const TeradataEncoder *e, unsigned char **data,
+    const uint16_t length);
+PyObject* teradata_row_to_pylazy(const TeradataEncoder *e, unsigned char **data,
+    const uint16_t length);
+PyObject* teradata_buffer_to_pylazy(const TeradataEncoder *e, unsigned char **data,
+    const uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -35,6 +35,81 @@ uint32_t teradata_buffer_count_rows(unsigned char *data, const uint32_t length)
     return n;
 }
 
+// Rows of a fixed layout are located directly, otherwise the length
+// prefixes of the preceding rows have to be walked.
+PyObject* teradata_buffer_row_at(const TeradataEncoder *e, unsigned char **data, const uint32_t length,
+        const uint32_t index) {
+    unsigned char *start = *data;
+    uint16_t row_length = 0;
+    uint32_t i;
+    if (e->FixedRowLength > 0) {
+        *data += (size_t)index * (e->FixedRowLength + sizeof(uint16_t));
+    } else {
+        for (i=0; i<index && (size_t)(*data-start) + sizeof(uint16_t) <= length; i++) {
+            unpack_uint16_t(data, &row_length);
+            *data += row_length;
+        }
+    }
+    if ((size_t)(*data-start) + sizeof(uint16_t) > length) {
+        PyErr_Format(PyExc_IndexError, "Row index %u out of range", index);
+        return NULL;
+    }
+    unpack_uint16_t(data, &row_length);
+    if ((size_t)(*data-start) + row_length > length) {
+        PyErr_Format(PyExc_IndexError, "Row index %u out of range", index);
+        return NULL;
+    }
+    if (e->FixedRowLength > 0 && row_length != e->FixedRowLength) {
+        PyErr_Format(EncoderError, "Row length %u does not match the fixed row length %u of the columns",
+            row_length, e->FixedRowLength);
+        return NULL;
+    }
+    return e->UnpackRowFunc(e, data, row_length);
+}
+
+// Decodes the values of a single column by indexing each row directly,
+// which is only possible for columns with a fixed row layout.
+PyObject* teradata_buffer_column_at(const TeradataEncoder *e, unsigned char **data, const uint32_t length,
+        const uint32_t index) {
+    PyObject *values, *item;
+    GiraffeColumn *column;
+    unsigned char *row, *p;
+    size_t stride, i, n;
+    if (e->FixedRowLength == 0) {
+        PyErr_SetString(EncoderError, "Column access requires columns without variable-length types");
+        return NULL;
+    }
+    if (index >= e->Columns->length) {
+        PyErr_Format(PyExc_IndexError, "Column index %u out of range", index);
+        return NULL;
+    }
+    stride = e->FixedRowLength + sizeof(uint16_t);
+    if (length % stride != 0) {
+        PyErr_Format(EncoderError, "Buffer length %u is not a multiple of the row length %u",
+            length, (uint32_t)stride);
+        return NULL;
+    }
+    column = &e->Columns->array[index];
+    n = length / stride;
+    Py_RETURN_ERROR(values = PyList_New(n));
+    for (i=0; i<n; i++) {
+        row = *data + i*stride + sizeof(uint16_t);
+        if (indicator_read(row, index)) {
+            Py_INCREF(e->NullValue);
+            PyList_SET_ITEM(values, i, e->NullValue);
+            continue;
+        }
+        p = row + e->Plan[index].offset;
+        if ((item = e->Plan[index].unpack(e, &p, column)) == NULL) {
+            Py_DECREF(values);
+            return NULL;
+        }
+        PyList_SET_ITEM(values, i, item);
+    }
+    *data += length;
+    return values;
+}
+
 PyObject* teradata_buffer_to_pybytes(const TeradataEncoder *e, unsigned char **data, const uint32_t length) {
     PyObject *result;
     result = PyTuple_New(1);
@@ -63,17 +138,18 @@ PyObject* teradata_row_to_pydict(const TeradataEncoder *e, unsigned char **data,
     PyObject *row;
     GiraffeColumn *column;
     size_t i;
+    int nulls;
     row = PyDict_New();
-    indicator_set(e->Columns, data);
+    nulls = indicator_set(e->Columns, data);
     for (i=0; i<e->Columns->length; i++) {
         column = &e->Columns->array[i];
-        if (indicator_read(e->Columns->buffer, i)) {
+        if (nulls && indicator_read(e->Columns->buffer, i)) {
             *data += column->NullLength;
-            PyDict_SetItemString(row, column->Title, e->NullValue);
+            PyDict_SetItem(row, e->Plan[i].key, e->NullValue);
             continue;
         }
-        Py_RETURN_ERROR(item = e->UnpackItemFunc(e, data, column));
-        PyDict_SetItemString(row, column->Title, item);
+        Py_RETURN_ERROR(item = e->Plan[i].unpack(e, data, column));
+        PyDict_SetItem(row, e->Plan[i].key, item);
         Py_DECREF(item);
     }
     return row;
@@ -84,17 +160,18 @@ PyObject* teradata_row_to_pytuple(const TeradataEncoder *e, unsigned char **data
     PyObject *row;
     GiraffeColumn *column;
     size_t i;
+    int nulls;
     row = PyTuple_New(e->Columns->length);
-    indicator_set(e->Columns, data);
+    nulls = indicator_set(e->Columns, data);
     for (i=0; i<e->Columns->length; i++) {
         column = &e->Columns->array[i];
-        if (indicator_read(e->Columns->buffer, i)) {
+        if (nulls && indicator_read(e->Columns->buffer, i)) {
             *data += column->NullLength;
             Py_INCREF(e->NullValue);
             PyTuple_SetItem(row, i, e->NullValue);
             continue;
         }
-        Py_RETURN_ERROR(item = e->UnpackItemFunc(e, data, column));
+        Py_RETURN_ERROR(item = e->Plan[i].unpack(e, data, column));
         PyTuple_SetItem(row, i, item);
     }
     return row;
@@ -110,81 +187,26 @@ PyObject* teradata_row_to_pystring(const TeradataEncoder *e, unsigned char **dat
     PyObject *row;
     GiraffeColumn *column;
     size_t i;
-    int n;
-    char item[BUFFER_ITEM_SIZE];
-    int8_t b; int16_t h; int32_t l; int64_t q; double d; uint16_t H;
-    indicator_set(e->Columns, data);
+    int nulls;
+    nulls = indicator_set(e->Columns, data);
     buffer_reset(e->buffer, 0);
     for (i=0; i<e->Columns->length; i++) {
         column = &e->Columns->array[i];
-        if (indicator_read(e->Columns->buffer, i)) {
+        if (nulls && indicator_read(e->Columns->buffer, i)) {
             *data += column->NullLength;
             buffer_write(e->buffer, e->NullValueStr, e->NullValueStrLen);
-            if (i != e->Columns->length-1) {
-                buffer_write(e->buffer, e->DelimiterStr, e->DelimiterStrLen);
-            }
-            continue;
-        }
-        switch (column->GDType) {
-            case GD_BYTEINT:
-                unpack_int8_t(data, &b);
-                buffer_writef(e->buffer, "%d", b);
-                break;
-            case GD_SMALLINT:
-                unpack_int16_t(data, &h);
-                buffer_writef(e->buffer, "%d", h);
-                break;
-            case GD_INTEGER:
-                unpack_int32_t(data, &l);
-                buffer_writef(e->buffer, "%d", l);
-                break;
-            case GD_BIGINT:
-                unpack_int64_t(data, &q);
-                buffer_writef(e->buffer, "%lld", q);
-                break;
-            case GD_FLOAT:
-                unpack_float(data, &d);
-                buffer_writef(e->buffer, "%.16g", d);
-                break;
-            case GD_DECIMAL:
-                if ((n = teradata_decimal_to_cstring(data, column->Length, column->Scale, item)) < 0) {
-                    PyErr_SetString(EncoderError, "Unexpected error while converting decimal");
-                    return NULL;
-                }
-                buffer_write(e->buffer, item, n);
-                break;
-            case GD_CHAR:
-                buffer_write(e->buffer, (char*)*data, column->Length);
-                *data += column->Length;
-                break;
-            case GD_VARCHAR:
-                unpack_uint16_t(data, &H);
-                buffer_write(e->buffer, (char*)*data, H);
-                *data += H;
-                break;
-            case GD_DATE:
-                if ((n = teradata_date_to_cstring(data, item)) < 0) {
-                    PyErr_SetString(EncoderError, "Unexpected error while converting date");
-                    return NULL;
-                }
-                buffer_write(e->buffer, item, n);
-                break;
-            case GD_NUMBER:
-                if ((n = teradata_number_to_cstring(data, item)) < 0) {
-                    PyErr_SetString(EncoderError, "Unexpected error while converting number");
-                    return NULL;
-                }
-                buffer_write(e->buffer, item, n);
-                break;
-            default:
-                buffer_write(e->buffer, (char*)*data, column->Length);
-                *data += column->Length;
+        } else if (e->Plan[i].write(e, data, column) != 0) {
+            return NULL;
         }
         if (i != e->Columns->length-1) {
             buffer_write(e->buffer, e->DelimiterStr, e->DelimiterStrLen);
         }
     }
-    Py_RETURN_ERROR(row = PyUnicode_FromStringAndSize(e->buffer->data, e->buffer->length));
+    if (e->Charset == CHARSET_LATIN1) {
+        Py_RETURN_ERROR(row = latin1_to_pystring(e->buffer->data, e->buffer->length));
+    } else {
+        Py_RETURN_ERROR(row = utf8_to_pystring(e->buffer->data, e->buffer->length));
+    }
     return row;
 }
 
@@ -210,16 +232,37 @@ PyObject* teradata_item_to_pyobject(const TeradataEncoder *e, unsigned char **da
             }
             return e->UnpackDecimalFunc(item, n);
         case GD_CHAR:
+            if (e->Settings & STRING_TRIM_CHAR) {
+                if (e->Charset == CHARSET_LATIN1) {
+                    return teradata_char_to_pystring_latin1_trim(data, column->Length, column->FormatLength);
+                }
+                return teradata_char_to_pystring_trim(data, column->Length, column->FormatLength);
+            }
+            if (e->Charset == CHARSET_LATIN1) {
+                return teradata_char_to_pystring_latin1(data, column->Length, column->FormatLength);
+            }
             return teradata_char_to_pystring_f(data, column->Length, column->FormatLength);
         case GD_VARCHAR:
+            if (e->Charset == CHARSET_LATIN1) {
+                return teradata_varchar_to_pystring_latin1(data);
+            }
             return teradata_varchar_to_pystring(data);
         case GD_DATE:
             return e->UnpackDateFunc(data);
         case GD_TIME:
+            if (column_has_time_zone(column) && (e->Settings & DATETIME_RETURN_MASK) != DATETIME_AS_EPOCH) {
+                return teradata_char_to_pystring(data, column->Length);
+            }
             return e->UnpackTimeFunc(data, column->Length);
         case GD_TIMESTAMP:
+            if (column_has_time_zone(column) && (e->Settings & DATETIME_RETURN_MASK) != DATETIME_AS_EPOCH) {
+                return teradata_char_to_pystring(data, column->Length);
+            }
             return e->UnpackTimestampFunc(data, column->Length);
         case GD_NUMBER:
+            if ((e->Settings & DECIMAL_RETURN_MASK) == DECIMAL_AS_SCALED_INT) {
+                return teradata_number_to_scaled_pylong(data, column->Scale);
+            }
             if ((n = teradata_number_to_cstring(data, item)) < 0) {
                 return NULL;
             }
@@ -259,16 +302,23 @@ static inline PyObject* pack_none(const GiraffeColumn *column, unsigned char **b
 
 PyObject* teradata_row_from_unknown(const TeradataEncoder *e, PyObject *row, unsigned char **data,
         uint16_t *length) {
+    uint32_t encoding;
     if (PyDict_Check(row)) {
-        encoder_set_encoding((TeradataEncoder*)e, ROW_ENCODING_DICT);
+        encoding = ROW_ENCODING_DICT;
     } else if (PyUnicode_Check(row) || PyBytes_Check(row)) {
-        encoder_set_encoding((TeradataEncoder*)e, ROW_ENCODING_STRING);
+        encoding = ROW_ENCODING_STRING;
     } else if (PyTuple_Check(row) || PyList_Check(row)) {
-        encoder_set_encoding((TeradataEncoder*)e, ROW_ENCODING_LIST);
+        encoding = ROW_ENCODING_LIST;
     } else {
         PyErr_Format(EncoderError, "Row type '%s' cannot be serialized.", Py_TYPE(row)->tp_name);
         return NULL;
     }
+    // the rest of the settings are kept so the pack plan is recompiled
+    // for the new row encoding
+    if (encoder_set_encoding((TeradataEncoder*)e, (e->Settings & ~ROW_RETURN_MASK) | encoding) != 0) {
+        PyErr_SetString(EncoderError, "Unable to compile the pack plan");
+        return NULL;
+    }
     return e->PackRowFunc(e, row, data, length);
 }
 
@@ -291,51 +341,95 @@ PyObject* teradata_row_from_pybytes(const TeradataEncoder *e, PyObject *row, uns
 
 PyObject* teradata_row_from_pystring(const TeradataEncoder *e, PyObject *row, unsigned char **data,
         uint16_t *length) {
-    PyObject *items;
+    PyObject *items, *result;
     if (!(PyStr_Check(row) || PyBytes_Check(row))) {
         return teradata_row_from_unknown(e, row, data, length);
     }
     if ((items = PyUnicode_Split(row, e->Delimiter, e->Columns->length-1)) == NULL) {
         return NULL;
     }
-    if (teradata_row_from_pytuple(e, items, data, length) == NULL) {
-        return NULL;
+    result = teradata_row_from_pytuple(e, items, data, length);
+    Py_DECREF(items);
+    return result;
+}
+
+// Compares against the null value by identity first.  None is only ever
+// matched by identity, the way Python spells `is None`, which saves
+// objects like Decimal a slow and pointless rich comparison.  Otherwise
+// equality is only skipped when both are different builtin types that
+// can never compare equal, so subclasses and other objects still get the
+// full comparison.
+#ifdef _MSC_VER
+static __inline int pack_is_null(const TeradataEncoder *e, PyObject *item) {
+#else
+static inline int pack_is_null(const TeradataEncoder *e, PyObject *item) {
+#endif
+    PyObject *null = e->NullValue;
+    if (item == null) {
+        return 1;
     }
-    Py_RETURN_NONE;
+    if (null == Py_None) {
+        return 0;
+    }
+    if (PyUnicode_CheckExact(null) && Py_TYPE(item) != Py_TYPE(null)
+            && (item == Py_None || PyUnicode_CheckExact(item) || PyLong_CheckExact(item)
+                || PyFloat_CheckExact(item))) {
+        return 0;
+    }
+    return PyObject_RichCompareBool(item, null, Py_EQ);
+}
+
+#ifdef _MSC_VER
+static __inline int pack_item(const TeradataEncoder *e, size_t i, PyObject *item, unsigned char **ind,
+#else
+static inline int pack_item(const TeradataEncoder *e, size_t i, PyObject *item, unsigned char **ind,
+#endif
+        unsigned char **data, uint16_t *length) {
+    int nullable;
+    if ((nullable = pack_is_null(e, item)) == -1) {
+        return -1;
+    }
+    if (nullable) {
+        indicator_write(ind, i, 1);
+        pack_none(&e->Columns->array[i], data, length);
+        return 0;
+    }
+    return e->PackPlan[i].pack(e, &e->Columns->array[i], item, data, length);
 }
 
 PyObject* teradata_row_from_pydict(const TeradataEncoder *e, PyObject *row, unsigned char **data,
         uint16_t *length) {
-    PyObject *items;
     PyObject *item;
     size_t i;
-    GiraffeColumn *column;
+    unsigned char *ind;
     if (!PyDict_Check(row)) {
         return teradata_row_from_unknown(e, row, data, length);
     }
-    items = PyList_New(e->Columns->length);
+    ind = *data;
+    indicator_clear(&ind, e->Columns->header_length);
+    *data += e->Columns->header_length;
+    *length += e->Columns->header_length;
     for (i=0; i<e->Columns->length; i++) {
-        column = &e->Columns->array[i];
-        if ((item = PyDict_GetItemString(row, column->Name)) == NULL) {
+        if ((item = PyDict_GetItem(row, e->PackPlan[i].key)) == NULL) {
             item = Py_None;
         }
-        Py_INCREF(item);
-        PyList_SetItem(items, i, item);
-    }
-    if (teradata_row_from_pytuple(e, items, data, length) == NULL) {
-        return NULL;
+        if (pack_item(e, i, item, &ind, data, length) == -1) {
+            return NULL;
+        }
     }
     Py_RETURN_NONE;
 }
 
 PyObject* teradata_row_from_pytuple(const TeradataEncoder *e, PyObject *row, unsigned char **data,
         uint16_t *length) {
-    PyObject *item = NULL;
-    GiraffeColumn *column;
+    PyObject *item;
+    PyObject **items = NULL;
     Py_ssize_t i, slength;
-    int nullable;
     unsigned char *ind;
-    if (!(PyTuple_Check(row) || PyList_Check(row))) {
+    int ret;
+    if (PyTuple_Check(row) || PyList_Check(row)) {
+        items = PySequence_Fast_ITEMS(row);
+    } else if (!(PyObject_TypeCheck(row, &RecordType) || PyObject_TypeCheck(row, &LazyRecordType))) {
         return teradata_row_from_unknown(e, row, data, length);
     }
     if ((slength = PySequence_Size(row)) == -1) {
@@ -350,53 +444,141 @@ PyObject* teradata_row_from_pytuple(const TeradataEncoder *e, PyObject *row, uns
     *data += e->Columns->header_length;
     *length += e->Columns->header_length;
     for (i=0; i<slength; i++) {
-        column = &e->Columns->array[i];
-        Py_RETURN_ERROR(item = PySequence_GetItem(row, i));
-        if ((nullable = PyObject_RichCompareBool(item, e->NullValue, Py_EQ)) == -1) {
-            return NULL;
-        }
-        if (nullable) {
-            indicator_write(&ind, i, 1);
-            pack_none(column, data, length);
-            continue;
+        if (items != NULL) {
+            ret = pack_item(e, i, items[i], &ind, data, length);
+        } else {
+            Py_RETURN_ERROR(item = PySequence_GetItem(row, i));
+            ret = pack_item(e, i, item, &ind, data, length);
+            Py_DECREF(item);
         }
-        if (e->PackItemFunc(e, column, item, data, length) == NULL) {
+        if (ret == -1) {
             return NULL;
         }
     }
-    Py_DECREF(item);
     Py_RETURN_NONE;
 }
 
-PyObject* teradata_item_from_pyobject(const TeradataEncoder *e, const GiraffeColumn *column,
-        PyObject *item, unsigned char **data, uint16_t *length) {
-    switch (column->GDType) {
-        case GD_BYTEINT:
-            return teradata_byteint_from_pylong(item, column->Length, data, length);
-        case GD_SMALLINT:
-            return teradata_smallint_from_pylong(item, column->Length, data, length);
-        case GD_INTEGER:
-            return teradata_int_from_pylong(item, column->Length, data, length);
-        case GD_BIGINT:
-            return teradata_bigint_from_pylong(item, column->Length, data, length);
-        case GD_FLOAT:
-            return teradata_float_from_pyfloat(item, column->Length, data, length);
-        case GD_DECIMAL:
-            return teradata_decimal_from_pystring(item, column->Length, column->Scale, data, length);
-        case GD_CHAR:
-            return teradata_char_from_pystring(item, column->Length, data, length);
-        case GD_VARCHAR:
-            return teradata_varchar_from_pystring(item, data, length);
-        case GD_DATE:
-            return teradata_dateint_from_pystring(item, column->Length, data, length);
-        case GD_TIME:
-            return teradata_datetime_from_pystring(item, column->Length, data, length);
-        case GD_TIMESTAMP:
-            return teradata_datetime_from_pystring(item, column->Length, data, length);
-        case GD_NUMBER:
-            return teradata_number_from_pystring(item, data, length);
-        default:
-            return teradata_char_from_pystring(item, column->Length, data, length);
+// Errors caused by the values of a row, which skip the row instead of
+// stopping the whole buffer
+#ifdef _MSC_VER
+static __inline int pack_error_is_row_error(void) {
+#else
+static inline int pack_error_is_row_error(void) {
+#endif
+    return PyErr_ExceptionMatches(EncoderError) || PyErr_ExceptionMatches(PyExc_ValueError)
+        || PyErr_ExceptionMatches(PyExc_TypeError) || PyErr_ExceptionMatches(PyExc_OverflowError);
+}
+
+static int pack_error_append(PyObject *errors, Py_ssize_t index) {
+    PyObject *type, *value, *traceback, *error;
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+    error = Py_BuildValue("(nO)", index, value != NULL ? value : Py_None);
+    Py_XDECREF(type);
+    Py_XDECREF(value);
+    Py_XDECREF(traceback);
+    if (error == NULL) {
+        return -1;
     }
+    if (PyList_Append(errors, error) == -1) {
+        Py_DECREF(error);
+        return -1;
+    }
+    Py_DECREF(error);
+    return 0;
+}
+
+// Packs the rows of an iterator into one buffer of length-prefixed rows,
+// the layout read by teradata_buffer_count_rows and UnpackRowsFunc.  Rows
+// failing on their values are left out and reported in errors as
+// (index, exception).  Other errors, like those of the iterator itself,
+// are raised and leave held and index as they were.
+//
+// With max_bytes set the buffer never grows past it.  Rows are packed in
+// place, so the row that does not fit has already been taken from the
+// iterator.  It is returned in held (a new reference) for the caller to
+// pass back with the next call, which writes it first.  held is NULL
+// once the iterator is exhausted.  index is the position of the first
+// row, the held one included, and is advanced past the rows taken.  A
+// row that would not fit in max_bytes on its own is an error.
+PyObject* teradata_buffer_from_pyiter(const TeradataEncoder *e, PyObject *iter, const size_t max_bytes,
+        PyObject **held, Py_ssize_t *index, PyObject *errors) {
+    PyObject *row, *next = NULL, *result = NULL;
+    unsigned char *buf, *data, *tmp;
+    size_t size, pos = 0;
+    Py_ssize_t i = *index;
+    uint16_t length;
+    size = max_bytes + 2 * (TD_ROW_MAX_SIZE + sizeof(uint16_t));
+    if ((buf = (unsigned char*)malloc(size)) == NULL) {
+        return PyErr_NoMemory();
+    }
+    if (*held != NULL) {
+        if (max_bytes > 0 && (size_t)PyBytes_GET_SIZE(*held) > max_bytes) {
+            PyErr_Format(EncoderError, "Row length %lu exceeds max_bytes %lu",
+                (unsigned long)(PyBytes_GET_SIZE(*held) - sizeof(uint16_t)), (unsigned long)max_bytes);
+            if (pack_error_append(errors, i) == -1) {
+                goto error;
+            }
+        } else {
+            memcpy(buf, PyBytes_AS_STRING(*held), PyBytes_GET_SIZE(*held));
+            pos = PyBytes_GET_SIZE(*held);
+        }
+        i++;
+    }
+    while ((row = PyIter_Next(iter)) != NULL) {
+        if (pos + sizeof(uint16_t) + TD_ROW_MAX_SIZE > size) {
+            size *= 2;
+            if ((tmp = (unsigned char*)realloc(buf, size)) == NULL) {
+                Py_DECREF(row);
+                PyErr_NoMemory();
+                goto error;
+            }
+            buf = tmp;
+        }
+        data = buf + pos + sizeof(uint16_t);
+        length = 0;
+        result = e->PackRowFunc(e, row, &data, &length);
+        Py_DECREF(row);
+        if (result == NULL) {
+            if (!pack_error_is_row_error() || pack_error_append(errors, i) == -1) {
+                goto error;
+            }
+            i++;
+            continue;
+        }
+        Py_CLEAR(result);
+        data = buf + pos;
+        pack_uint16_t(&data, length);
+        if (max_bytes > 0 && sizeof(uint16_t) + length > max_bytes) {
+            PyErr_Format(EncoderError, "Row length %u exceeds max_bytes %lu", length,
+                (unsigned long)max_bytes);
+            if (pack_error_append(errors, i) == -1) {
+                goto error;
+            }
+            i++;
+            continue;
+        }
+        if (max_bytes > 0 && pos + sizeof(uint16_t) + length > max_bytes) {
+            if ((next = PyBytes_FromStringAndSize((char*)buf + pos, sizeof(uint16_t) + length)) == NULL) {
+                goto error;
+            }
+            break;
+        }
+        pos += sizeof(uint16_t) + length;
+        i++;
+    }
+    if (PyErr_Occurred()) {
+        goto error;
+    }
+    if ((result = PyBytes_FromStringAndSize((char*)buf, pos)) == NULL) {
+        goto error;
+    }
+    *held = next;
+    *index = i;
+    free(buf);
+    return result;
+error:
+    Py_XDECREF(next);
+    free(buf);
     return NULL;
 }
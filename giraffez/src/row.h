@@ -35,11 +35,15 @@ PyObject* teradata_row_from_pystring(const TeradataEncoder *e, PyObject *row, un
     uint16_t *length);
 PyObject* teradata_row_from_pytuple(const TeradataEncoder *e, PyObject *row, unsigned char **data,
     uint16_t *length);
-PyObject* teradata_item_from_pyobject(const TeradataEncoder *e, const GiraffeColumn *column,
-    PyObject *item, unsigned char **data, uint16_t *length);
+PyObject* teradata_buffer_from_pyiter(const TeradataEncoder *e, PyObject *iter, const size_t max_bytes,
+    PyObject **held, Py_ssize_t *index, PyObject *errors);
 
 // unpack
 uint32_t  teradata_buffer_count_rows(unsigned char *data, const uint32_t length);
+PyObject* teradata_buffer_row_at(const TeradataEncoder *e, unsigned char **data, const uint32_t length,
+    const uint32_t index);
+PyObject* teradata_buffer_column_at(const TeradataEncoder *e, unsigned char **data, const uint32_t length,
+    const uint32_t index);
 PyObject* teradata_buffer_to_pybytes(const TeradataEncoder *e, unsigned char **data, const uint32_t length);
 PyObject* teradata_buffer_to_pylist(const TeradataEncoder *e, unsigned char **data, const uint32_t length);
 
@@ -50,8 +54,6 @@ PyObject* teradata_row_to_pytuple(const TeradataEncoder *e, unsigned char **data
 
 PyObject* teradata_item_to_pyobject(const TeradataEncoder *e, unsigned char **data,
     const GiraffeColumn *column);
-PyObject* teradata_item_from_pystring(const TeradataEncoder *e, const GiraffeColumn *column,
-    PyObject *item, unsigned char **data, uint16_t *length);
 
 #ifdef __cplusplus
 }
@@ -127,7 +127,7 @@ PyObject* teradata_close(TeradataConnection *conn) {
 }
 
 TeradataConnection* teradata_connect(const char *host, const char *username,
-        const char *password, const char *logon_mech, const char *logon_mech_data) {
+        const char *password, const char *logon_mech, const char *logon_mech_data, const char *charset) {
     int status;
     TeradataConnection *conn;
     conn = teradata_new();
@@ -168,8 +168,11 @@ TeradataConnection* teradata_connect(const char *host, const char *username,
     conn->dbc->date_form = 'T';
     conn->dbc->tx_semantics = 'T';
     conn->dbc->consider_APH_resps = 'Y';
+    if (charset == NULL) {
+        charset = TERADATA_CHARSET;
+    }
     snprintf(conn->session_charset, sizeof(conn->session_charset), "%-*s",
-        (int)(sizeof(conn->session_charset)-strlen(TERADATA_CHARSET)), TERADATA_CHARSET);
+        (int)(sizeof(conn->session_charset)-strlen(charset)), charset);
     conn->dbc->inter_ptr = conn->session_charset;
     sprintf(conn->logonstr, "%s/%s,%s", host, username, password);
     conn->dbc->logon_ptr = conn->logonstr;
@@ -372,7 +375,9 @@ PyObject* teradata_handle_parcel_state(TeradataEncoder *encoder, const uint32_t
     switch (parcel_t) {
         case PclSTATEMENTINFO:
             encoder_clear(encoder);
-            encoder->Columns = encoder->UnpackStmtInfoFunc(data, length);
+            if (encoder_set_columns(encoder, encoder->UnpackStmtInfoFunc(data, length)) != 0) {
+                return PyErr_NoMemory();
+            }
             break;
         case PclSTATEMENTINFOEND:
             PyErr_SetNone(EndStatementInfoError);
@@ -756,10 +761,10 @@ uint16_t teradata_type_to_giraffez_type(uint16_t t) {
             return GD_TIMESTAMP;
         case TIME_NNZ:
         case TIME_NZ:
-            return GD_CHAR;
+            return GD_TIME;
         case TIMESTAMP_NNZ:
         case TIMESTAMP_NZ:
-            return GD_CHAR;
+            return GD_TIMESTAMP;
         case INTERVAL_YEAR_NN:
         case INTERVAL_YEAR_N:
         case INTERVAL_YEAR_TO_MONTH_NN:
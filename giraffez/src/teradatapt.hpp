@@ -18,6 +18,7 @@
 #define __GIRAFFEZ_CONNECTION_H
 
 #include "common.h"
+#include "arrow.h"
 #include "columns.h"
 #include "convert.h"
 #include "encoder.h"
@@ -169,6 +170,15 @@ namespace Giraffez {
             return encoder->UnpackRowsFunc(encoder, &data, length);
         }
 
+        PyObject* GetArrowBatch() {
+            unsigned char *data = NULL;
+            int length;
+            if ((int)this->conn->GetBuffer((char**)&data, (TD_Length*)&length) == TD_END_METHOD) {
+                Py_RETURN_NONE;
+            }
+            return teradata_buffer_to_arrow(encoder, &data, length);
+        }
+
         PyObject* GetEvent(TD_EventType event_type, TD_Index index) {
             char *data = NULL;
             TD_Length length = 0;
@@ -255,7 +265,7 @@ namespace Giraffez {
             if (prepare_only) {
                 cursor->req_proc_opt = 'P';
             }
-            if ((cmd = teradata_connect(host, username, password, logon_mech, logon_mech_data)) == NULL) {
+            if ((cmd = teradata_connect(host, username, password, logon_mech, logon_mech_data, NULL)) == NULL) {
                 goto error;
             }
             if (teradata_execute(cmd, e, cursor) == NULL) {
@@ -315,7 +325,7 @@ error:
             encoder_clear(encoder);
             cursor = cursor_new(query);
             cursor->req_proc_opt = 'P';
-            if ((cmd = teradata_connect(host, username, password, logon_mech, logon_mech_data)) == NULL) {
+            if ((cmd = teradata_connect(host, username, password, logon_mech, logon_mech_data, NULL)) == NULL) {
                 goto error;
             }
             if (teradata_execute(cmd, encoder, cursor) == NULL) {
@@ -338,7 +348,7 @@ error:
             table_name = std::string(tbl_name);
             cursor = cursor_new(strdup(("select top 1 * from " + table_name).c_str()));
             cursor->req_proc_opt = 'P';
-            if ((cmd = teradata_connect(host, username, password, logon_mech, logon_mech_data)) == NULL) {
+            if ((cmd = teradata_connect(host, username, password, logon_mech, logon_mech_data, NULL)) == NULL) {
                 goto error;
             }
             if (teradata_execute(cmd, encoder, cursor) == NULL) {
@@ -399,7 +409,12 @@ error:
                         }
                     }
                 }
-                encoder->Columns = ncolumns;
+                // ncolumns shares the column strings with the previous
+                // set, so only the plan is replaced here
+                if (encoder_set_columns(encoder, ncolumns) != 0) {
+                    PyErr_NoMemory();
+                    return NULL;
+                }
             }
             // TODO: May not be necessary to specify the column names, since it
             // appears to pull that from what is added via AddColumn (possibly)
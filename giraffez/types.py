@@ -543,6 +543,8 @@ class Timestamp(Date):
     Represents Teradata date/time data types such as TIMESTAMP(n).
     """
 
+    _original_length = None
+
     def __init__(self, *args, **kwargs):
         super(Timestamp, self).__init__(*args, **kwargs)
         self._original_length = None
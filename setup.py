@@ -180,11 +180,16 @@ class TeradataExtension(Extension):
     name = "giraffez._teradata"
 
     sources = [
+        "giraffez/src/arrow.c",
         "giraffez/src/buffer.c",
+        "giraffez/src/columnar.c",
         "giraffez/src/columns.c",
         "giraffez/src/convert.c",
         "giraffez/src/encoder.c",
         "giraffez/src/errors.c",
+        "giraffez/src/grisu.c",
+        "giraffez/src/plan.c",
+        "giraffez/src/record.c",
         "giraffez/src/row.c",
         "giraffez/src/teradata.c",
         "giraffez/_teradatamodule.c",
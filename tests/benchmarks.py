@@ -2,10 +2,11 @@
 
 from __future__ import division
 
+import datetime
+import decimal
 import pytest
 
 import giraffez
-from giraffez import _encoder
 from giraffez.constants import *
 from giraffez.errors import *
 from giraffez.encoders import *
@@ -37,3 +38,299 @@ import struct
     #row = struct.pack('h', len(row)) + row
 
     #result = benchmark(unpack_rows, columns, row, n=1)
+
+
+# A wide schema of 200 columns is the typical shape of ETL extracts so the
+# columns cycle through the common types.
+WIDE_TYPES = [
+    (INTEGER_NN, 4, 0, 0, 1000),
+    (DECIMAL_NN, 8, 18, 2, "100000.02"),
+    (VARCHAR_NN, 50, 0, 0, "testing"),
+    (DATE_NN, 4, 0, 0, "2015-01-01"),
+    (CHAR_NN, 10, 0, 0, "testing   "),
+    (FLOAT_NN, 8, 0, 0, 1.5),
+    (BIGINT_NN, 8, 0, 0, 100000000001),
+    (SMALLINT_NN, 2, 0, 0, 12),
+    (DECIMAL_NN, 4, 9, 4, "-1234.5678"),
+    (TIMESTAMP_NN, 19, 0, 0, "2015-01-01 12:34:56"),
+]
+
+def wide_buffer(n=200, size=64000):
+    columns = Columns([("col{}".format(i),) + WIDE_TYPES[i % len(WIDE_TYPES)][:4] for i in range(n)])
+    encoder = giraffez.Encoder(columns)
+    values = [WIDE_TYPES[i % len(WIDE_TYPES)][4] for i in range(n)]
+    # Roughly one in ten values is null
+    nulls = [None if i % 10 == 9 else v for i, v in enumerate(values)]
+    data = b""
+    i = 0
+    while True:
+        row = encoder.serialize(nulls if i % 2 else values)
+        row = struct.pack("H", len(row)) + row
+        if len(data) + len(row) > size:
+            break
+        data += row
+        i += 1
+    return encoder, data
+
+@pytest.mark.parametrize("encoding", [
+    ROW_ENCODING_LIST,
+    ROW_ENCODING_DICT,
+    ROW_ENCODING_RECORD,
+    ENCODER_SETTINGS_STRING,
+], ids=["list", "dict", "record", "str"])
+def test_cencoder_unpack_wide(benchmark, encoding):
+    encoder, data = wide_buffer()
+    encoder |= encoding
+    benchmark(encoder.readbuffer, data)
+
+# Filtering on a single column, where lazy rows only decode that column
+@pytest.mark.parametrize("encoding", [
+    ROW_ENCODING_LIST,
+    ROW_ENCODING_LAZY,
+], ids=["list", "lazy"])
+def test_cencoder_filter_wide(benchmark, encoding):
+    encoder, data = wide_buffer()
+    encoder |= encoding
+    benchmark(lambda: [row for row in encoder.readbuffer(data) if row[1] == 12])
+
+# BulkLoad rows as read from a file or produced by a generator, packed one
+# at a time as in TeradataBulkLoad.put
+LOAD_TYPES = [
+    (INTEGER_N, 4, 0, 0, 1000),
+    (BIGINT_N, 8, 0, 0, 100000000001),
+    (FLOAT_N, 8, 0, 0, 1.5),
+    (VARCHAR_N, 50, 0, 0, u"customer name"),
+    (CHAR_N, 10, 0, 0, u"ABC123"),
+    (SMALLINT_N, 2, 0, 0, None),
+    (VARCHAR_N, 200, 0, 0, u"1600 Pennsylvania Avenue NW"),
+    (DECIMAL_N, 8, 18, 2, "100000.02"),
+    (DATE_N, 4, 0, 0, "2015-01-01"),
+    (INTEGER_N, 4, 0, 0, None),
+]
+
+@pytest.mark.parametrize("kind", ["tuple", "dict", "str"])
+def test_cencoder_pack_rows(benchmark, kind):
+    columns = Columns([("col{}".format(i),) + t[:4] for i, t in enumerate(LOAD_TYPES)])
+    encoder = giraffez.Encoder(columns)
+    row = tuple(t[4] for t in LOAD_TYPES)
+    if kind == "dict":
+        row = dict(zip(columns.names, row))
+    elif kind == "str":
+        encoder |= ROW_ENCODING_STRING
+        encoder.null = "NULL"
+        row = u"|".join("NULL" if v is None else str(v) for v in row)
+    rows = [row] * 1000
+    benchmark(lambda: [encoder.serialize(r) for r in rows])
+
+# The same rows packed into a single buffer, as written to archive files
+@pytest.mark.parametrize("kind", ["tuple", "dict", "str"])
+def test_cencoder_pack_buffer(benchmark, kind):
+    columns = Columns([("col{}".format(i),) + t[:4] for i, t in enumerate(LOAD_TYPES)])
+    encoder = giraffez.Encoder(columns)
+    row = tuple(t[4] for t in LOAD_TYPES)
+    if kind == "dict":
+        row = dict(zip(columns.names, row))
+    elif kind == "str":
+        encoder |= ROW_ENCODING_STRING
+        encoder.null = "NULL"
+        row = u"|".join("NULL" if v is None else str(v) for v in row)
+    rows = [row] * 1000
+    benchmark(lambda: encoder.serializebuffer(rows))
+
+# Decimal-heavy load, every DECIMAL width and NUMBER
+PACK_DECIMAL_TYPES = [
+    (DECIMAL_NN, 1, 2, 0, "42"),
+    (DECIMAL_NN, 2, 4, 2, "-12.34"),
+    (DECIMAL_NN, 4, 9, 2, "1234567.89"),
+    (DECIMAL_NN, 8, 18, 2, "-98765432101.23"),
+    (DECIMAL_NN, 8, 18, 4, "100000.02"),
+    (DECIMAL_NN, 16, 38, 10, "1234567890123456789.0123456789"),
+    (NUMBER_NN, 16, 38, 0, "3.14159"),
+    (NUMBER_NN, 16, 38, 0, "-123456789012345678901234"),
+]
+
+@pytest.mark.parametrize("kind", ["str", "decimal", "int"])
+def test_cencoder_pack_decimals(benchmark, kind):
+    columns = Columns([("col{}".format(i),) + t[:4] for i, t in enumerate(PACK_DECIMAL_TYPES)])
+    encoder = giraffez.Encoder(columns)
+    convert = {"str": str, "decimal": decimal.Decimal, "int": lambda s: int(decimal.Decimal(s))}[kind]
+    rows = [tuple(convert(t[4]) for t in PACK_DECIMAL_TYPES)] * 1000
+    benchmark(lambda: [encoder.serialize(r) for r in rows])
+
+# Date-heavy load, with dates in the formats commonly found in files
+PACK_DATE_TYPES = [
+    (DATE_NN, 4, 0, 0, "2015-01-09"),
+    (DATE_NN, 4, 0, 0, "20150109"),
+    (DATE_NN, 4, 0, 0, "01/09/2015"),
+    (DATE_NN, 4, 0, 0, "1150109"),
+    (TIME_NN, 15, 0, 0, "12:34:56.123456"),
+    (TIMESTAMP_NN, 19, 0, 0, "2015-01-09 12:34:56"),
+    (TIMESTAMP_NN, 26, 0, 0, "2015-01-09 12:34:56.123456"),
+]
+
+PACK_DATE_OBJECTS = {
+    (DATE_NN, 4): datetime.date(2015, 1, 9),
+    (TIME_NN, 15): datetime.time(12, 34, 56, 123456),
+    (TIMESTAMP_NN, 19): datetime.datetime(2015, 1, 9, 12, 34, 56),
+    (TIMESTAMP_NN, 26): datetime.datetime(2015, 1, 9, 12, 34, 56, 123456),
+}
+
+@pytest.mark.parametrize("kind", ["iso", "formats", "objects"])
+def test_cencoder_pack_dates(benchmark, kind):
+    types = PACK_DATE_TYPES
+    if kind == "iso":
+        types = [t[:4] + (PACK_DATE_TYPES[0][4],) if t[0] == DATE_NN else t for t in types]
+    elif kind == "objects":
+        types = [t[:4] + (PACK_DATE_OBJECTS[t[:2]],) for t in types]
+    columns = Columns([("col{}".format(i),) + t[:4] for i, t in enumerate(types)])
+    encoder = giraffez.Encoder(columns)
+    rows = [tuple(t[4] for t in types)] * 1000
+    benchmark(lambda: [encoder.serialize(r) for r in rows])
+
+# Integer-heavy extract used to measure text export.  Each 64KB buffer
+# holds 1488 rows, this benchmark decodes a single one.
+INTEGER_TYPES = [
+    (BYTEINT_NN, 1, 0, 0, -12),
+    (SMALLINT_NN, 2, 0, 0, 1234),
+    (INTEGER_NN, 4, 0, 0, 7),
+    (INTEGER_NN, 4, 0, 0, -2015011),
+    (INTEGER_NN, 4, 0, 0, 123456789),
+    (BIGINT_NN, 8, 0, 0, 100000000001),
+    (BIGINT_NN, 8, 0, 0, -42),
+    (DATE_NN, 4, 0, 0, "2015-01-01"),
+    (DATE_NN, 4, 0, 0, "1999-12-31"),
+]
+
+def test_cencoder_unpack_integers_str(benchmark):
+    columns = Columns([("col{}".format(i),) + t[:4] for i, t in enumerate(INTEGER_TYPES)])
+    encoder = giraffez.Encoder(columns)
+    row = encoder.serialize([t[4] for t in INTEGER_TYPES])
+    row = struct.pack("H", len(row)) + row
+    data = row * (64000 // len(row))
+    encoder |= ENCODER_SETTINGS_STRING
+    benchmark(encoder.readbuffer, data)
+
+# Monetary DECIMAL(18,2) columns, the most common decimal in extracts
+def test_cencoder_unpack_decimals_str(benchmark):
+    columns = Columns([("col{}".format(i), DECIMAL_NN, 8, 18, 2) for i in range(8)])
+    encoder = giraffez.Encoder(columns)
+    row = encoder.serialize(["1234567.89", "-0.05", "100.00", "-98765432101.23",
+        "42.42", "0.00", "9999999999999999.99", "-1.10"])
+    row = struct.pack("H", len(row)) + row
+    data = row * (64000 // len(row))
+    encoder |= ENCODER_SETTINGS_STRING
+    benchmark(encoder.readbuffer, data)
+
+@pytest.mark.parametrize("encoding", [
+    DECIMAL_AS_FLOAT,
+    DECIMAL_AS_GIRAFFEZ_DECIMAL,
+    DECIMAL_AS_SCALED_INT,
+], ids=["float", "decimal", "scaled_int"])
+def test_cencoder_unpack_decimals(benchmark, encoding):
+    columns = Columns([("col{}".format(i), DECIMAL_NN, 8, 18, 2 if i < 6 else 0) for i in range(8)])
+    encoder = giraffez.Encoder(columns)
+    row = encoder.serialize(["1234567.89", "-0.05", "100.00", "-98765432101.23",
+        "42.42", "0.00", "9999999999999999", "-110"])
+    row = struct.pack("H", len(row)) + row
+    data = row * (64000 // len(row))
+    encoder |= ROW_ENCODING_LIST
+    encoder |= encoding
+    benchmark(encoder.readbuffer, data)
+
+# Date-partitioned extract, every buffer repeats a handful of dates
+@pytest.mark.parametrize("encoding", [
+    DATETIME_AS_STRING,
+    DATETIME_AS_GIRAFFE_TYPES,
+    DATETIME_AS_PYDATETIME,
+    DATETIME_AS_EPOCH,
+], ids=["str", "giraffez", "pydatetime", "epoch"])
+def test_cencoder_unpack_dates(benchmark, encoding):
+    columns = Columns([("col{}".format(i), DATE_NN, 4, 0, 0) for i in range(4)])
+    encoder = giraffez.Encoder(columns)
+    data = b""
+    for i in range(64000 // 10):
+        row = encoder.serialize(["2015-01-{:02d}".format(1 + i % 3), "2015-01-01",
+            "1999-12-{:02d}".format(1 + i % 31), "2016-02-29"])
+        data += struct.pack("H", len(row)) + row
+    encoder |= ROW_ENCODING_LIST
+    encoder |= encoding
+    benchmark(encoder.readbuffer, data)
+
+# Clickstream extract with TIMESTAMP(6) and TIMESTAMP(0) columns
+@pytest.mark.parametrize("encoding", [
+    DATETIME_AS_STRING,
+    DATETIME_AS_GIRAFFE_TYPES,
+    DATETIME_AS_PYDATETIME,
+    DATETIME_AS_EPOCH,
+], ids=["str", "giraffez", "pydatetime", "epoch"])
+def test_cencoder_unpack_timestamps(benchmark, encoding):
+    columns = Columns([
+        ("col1", TIMESTAMP_NN, 26, 0, 0),
+        ("col2", TIMESTAMP_NN, 19, 0, 0),
+    ])
+    encoder = giraffez.Encoder(columns)
+    data = b""
+    for i in range(64000 // 48):
+        row = "\x002015-01-01 12:{:02d}:{:02d}.{:06d}2015-01-01 12:34:56".format(i // 60 % 60, i % 60, i)
+        data += struct.pack("H", len(row)) + row.encode("ascii")
+    encoder |= ROW_ENCODING_LIST
+    encoder |= encoding
+    benchmark(encoder.readbuffer, data)
+
+# Mostly ASCII text columns, as in typical dimension tables
+STRING_TYPES = [
+    (VARCHAR_NN, 50, 0, 0, "customer name"),
+    (CHAR_NN, 10, 0, 0, "ABC123    "),
+    (VARCHAR_NN, 200, 0, 0, "1600 Pennsylvania Avenue NW, Washington, DC 20500"),
+    (CHAR_NN, 2, 0, 0, "VA"),
+    (VARCHAR_NN, 50, 0, 0, u"caf\xe9"),
+]
+
+@pytest.mark.parametrize("charset", ["UTF8", "LATIN1"])
+def test_cencoder_unpack_strings(benchmark, charset):
+    columns = Columns([("col{}".format(i),) + t[:4] for i, t in enumerate(STRING_TYPES)])
+    encoder = giraffez.Encoder(columns, charset=charset)
+    row = encoder.serialize([t[4] for t in STRING_TYPES])
+    row = struct.pack("H", len(row)) + row
+    data = row * (64000 // len(row))
+    encoder |= ROW_ENCODING_LIST
+    benchmark(encoder.readbuffer, data)
+
+# Legacy table of wide CHAR columns, declared in characters so a UTF8
+# session pads them to 3 bytes per character
+@pytest.mark.parametrize("encoding", [
+    ROW_ENCODING_LIST,
+    ROW_ENCODING_LIST | STRING_TRIM_CHAR,
+    ENCODER_SETTINGS_STRING,
+    ENCODER_SETTINGS_STRING | STRING_TRIM_CHAR,
+], ids=["padded", "trimmed", "text-padded", "text-trimmed"])
+def test_cencoder_unpack_padded_chars(benchmark, encoding):
+    values = ["John", "Smith", "1600 Pennsylvania Ave", "Washington", "DC"]
+    columns = Columns([("col{}".format(i), CHAR_NN, n * 3, 0, 0)
+        for i, n in enumerate([30, 40, 100, 50, 2])])
+    encoder = giraffez.Encoder(columns)
+    row = encoder.serialize(values)
+    row = struct.pack("H", len(row)) + row
+    data = row * (64000 // len(row))
+    encoder |= encoding
+    benchmark(encoder.readbuffer, data)
+
+# Dimension snapshot with low-cardinality code columns and one unique name
+@pytest.mark.parametrize("encoding", [STRING_AS_NEW, STRING_AS_INTERNED], ids=["new", "interned"])
+def test_cencoder_unpack_codes(benchmark, encoding):
+    columns = Columns([
+        ("status", CHAR_NN, 1, 0, 0),
+        ("country", CHAR_NN, 2, 0, 0),
+        ("state", VARCHAR_NN, 20, 0, 0),
+        ("segment", VARCHAR_NN, 20, 0, 0),
+        ("name", VARCHAR_NN, 50, 0, 0),
+    ])
+    encoder = giraffez.Encoder(columns)
+    data = b""
+    for i in range(64000 // 60):
+        row = encoder.serialize(["AIX"[i % 3], "US", ["Virginia", "Maryland", "Texas"][i % 3],
+            ["Retail", "Commercial"][i % 2], "customer {}".format(i)])
+        data += struct.pack("H", len(row)) + row
+    encoder |= ROW_ENCODING_LIST
+    encoder |= encoding
+    benchmark(encoder.readbuffer, data)
@@ -3,7 +3,10 @@
 import pytest
 
 
+import datetime
 import decimal
+import random
+import struct
 import giraffez
 from giraffez._teradata import EncoderError
 from giraffez.constants import *
@@ -326,6 +329,18 @@ deserialize_only_tests = [
         "input_value": b'\x00TEST\x20\x20',
         "expected_value": "TEST  ",
     },
+    {
+        "name": "char_format_padding_full_column",
+        "column": ("col1", TD_CHAR, 8, 0, 0, "N", None, "X(6)"),
+        "input_value": b'\x00TEST\x20\x20\x20\x20',
+        "expected_value": "TEST  ",
+    },
+    {
+        "name": "char_format_padding_multibyte",
+        "column": ("col1", TD_CHAR, 8, 0, 0, "N", None, "X(4)"),
+        "input_value": b'\x00caf\xc3\xa9\x20\x20\x20',
+        "expected_value": u"caf\xe9",
+    },
 ]
 
 serialize_only_tests = [
@@ -550,6 +565,998 @@ class TestEncoder(object):
         result_text = encoder.read(expected_bytes)
         assert result_text == expected_text
 
+    def test_columnar(self, encoder):
+        """
+        Ensure a buffer of rows is decoded into one typed array per column
+        with a validity bitmap and offsets for variable-length values
+        """
+        encoder.columns = [
+            ('col1', TD_INTEGER, 4, 0, 0),
+            ('col2', TD_VARCHAR, 50, 0, 0),
+            ('col3', TD_DECIMAL, 4, 8, 2),
+            ('col4', TD_DATE, 4, 0, 0),
+            ('col5', TD_FLOAT, 8, 0, 0),
+        ]
+        rows = [
+            (1, "value1", "100.25", "2015-11-15", 1.5),
+            (None, "", None, None, None),
+            (3, "value3", "-0.75", "1899-12-31", -2.25),
+        ]
+        data = b""
+        for row in rows:
+            packed = encoder.serialize(row)
+            data += struct.pack("H", len(packed)) + packed
+        encoder |= ROW_ENCODING_COLUMNAR
+        result = encoder.readbuffer(data)
+        assert list(result.keys()) == ["col1", "col2", "col3", "col4", "col5"]
+
+        col1 = result["col1"]
+        assert isinstance(col1, giraffez._teradata.ColumnBuffer)
+        assert len(col1) == 3
+        assert col1.null_count == 1
+        assert memoryview(col1).format == "i"
+        assert memoryview(col1).tolist() == [1, 0, 3]
+        assert bytes(col1.validity) == b"\x05"
+
+        col2 = result["col2"]
+        assert len(col2) == 3
+        assert col2.null_count == 0
+        assert memoryview(col2.offsets).tolist() == [0, 6, 6, 12]
+        assert bytes(col2) == b"value1value3"
+        assert bytes(col2.validity) == b"\x07"
+
+        col3 = result["col3"]
+        assert col3.scale == 2
+        assert memoryview(col3).tolist() == [10025, 0, -75]
+        assert memoryview(result["col4"]).tolist() == [20151115, 0, 18991231]
+        assert memoryview(result["col5"]).tolist() == [1.5, 0.0, -2.25]
+
+        # Individual rows are still decoded as tuples
+        assert encoder.read(data[2:2+struct.unpack("H", data[:2])[0]]) == \
+            (1, "value1", "100.25", "2015-11-15", 1.5)
+
+        encoder |= ROW_ENCODING_LIST
+        assert encoder.readbuffer(b"") == []
+        encoder |= ROW_ENCODING_COLUMNAR
+        result = encoder.readbuffer(b"")
+        assert len(result["col1"]) == 0
+        assert len(result["col2"]) == 0
+
+        # Columns sharing a title would replace each other in the result
+        encoder.columns = [
+            {"name": "col1", "type": TD_INTEGER, "length": 4, "precision": 0, "scale": 0, "title": "dup"},
+            {"name": "col2", "type": TD_INTEGER, "length": 4, "precision": 0, "scale": 0, "title": "dup"},
+        ]
+        with pytest.raises(EncoderError):
+            encoder.readbuffer(b"")
+
+    def test_arrow(self, encoder):
+        """
+        Ensure a buffer of rows is exported through the Arrow C Data
+        Interface as a struct array with one child per column
+        """
+        encoder.columns = [
+            ('col1', TD_INTEGER, 4, 0, 0),
+            ('col2', TD_VARCHAR, 50, 0, 0),
+            ('col3', TD_DECIMAL, 4, 8, 2),
+            ('col4', TD_DATE, 4, 0, 0),
+            ('col5', TD_CHAR, 3, 0, 0),
+        ]
+        rows = [
+            (1, "value1", "100.25", "2015-11-15", "abc"),
+            (None, None, None, None, None),
+        ]
+        data = b""
+        for row in rows:
+            packed = encoder.serialize(row)
+            data += struct.pack("H", len(packed)) + packed
+        batch = encoder.readbuffer_arrow(data)
+        schema, array = batch.__arrow_c_array__()
+        assert type(schema).__name__ == "PyCapsule"
+        assert type(array).__name__ == "PyCapsule"
+        with pytest.raises(GiraffeError):
+            batch.__arrow_c_array__()
+
+        pa = pytest.importorskip("pyarrow")
+        result = pa.record_batch(encoder.readbuffer_arrow(data))
+        assert result.schema.names == ["col1", "col2", "col3", "col4", "col5"]
+        assert str(result.schema.field("col3").type) == "decimal128(8, 2)"
+        assert result.to_pylist() == [
+            {"col1": 1, "col2": "value1", "col3": decimal.Decimal("100.25"),
+                "col4": datetime.date(2015, 11, 15), "col5": "abc"},
+            {"col1": None, "col2": None, "col3": None, "col4": None, "col5": None},
+        ]
+
+        # LATIN1 strings are transcoded to UTF-8 for columnar and Arrow output
+        columns = Columns([('col1', VARCHAR_N, 10, 0, 0), ('col2', CHAR_N, 5, 0, 0)])
+        latin1 = giraffez.Encoder(columns, charset="LATIN1")
+        data = b""
+        for row in [(u"caf\xe9", u"d\xe9j\xe0"), (u"abc", None)]:
+            packed = latin1.serialize(row)
+            data += struct.pack("H", len(packed)) + packed
+        assert pa.record_batch(latin1.readbuffer_arrow(data)).to_pylist() == [
+            {"col1": u"caf\xe9", "col2": u"d\xe9j\xe0 "},
+            {"col1": u"abc", "col2": None},
+        ]
+        latin1 |= ROW_ENCODING_COLUMNAR
+        result = latin1.readbuffer(data)
+        assert bytes(result["col1"]) == u"caf\xe9abc".encode("utf-8")
+        assert bytes(result["col2"]) == u"d\xe9j\xe0 ".encode("utf-8")
+        assert memoryview(result["col2"].offsets).tolist() == [0, 7, 7]
+
+    def test_fixed_layout(self, encoder):
+        """
+        Ensure rows and columns of a buffer are located directly when the
+        columns have a fixed row layout, and that rows with variable-length
+        columns are still found by walking the buffer
+        """
+        encoder.columns = [
+            ('col1', TD_INTEGER, 4, 0, 0),
+            ('col2', TD_CHAR, 3, 0, 0),
+            ('col3', TD_DECIMAL, 4, 8, 2),
+            ('col4', TD_DATE, 4, 0, 0),
+        ]
+        rows = [
+            (1, "abc", "100.25", "2015-11-15"),
+            (None, "def", None, "1899-12-31"),
+            (3, None, "-0.75", None),
+        ]
+        data = b""
+        for row in rows:
+            packed = encoder.serialize(row)
+            data += struct.pack("H", len(packed)) + packed
+        encoder |= ROW_ENCODING_LIST
+        encoder |= DECIMAL_AS_STRING
+        for i, row in enumerate(rows):
+            assert encoder.read_at(data, i) == row
+        with pytest.raises(IndexError):
+            encoder.read_at(data, 3)
+        assert encoder.readcolumn(data, 0) == [1, None, 3]
+        assert encoder.readcolumn(data, "col3") == ["100.25", None, "-0.75"]
+        assert encoder.readcolumn(data, "col4") == ["2015-11-15", "1899-12-31", None]
+        with pytest.raises(EncoderError):
+            encoder.readcolumn(data[:-1], 0)
+
+        encoder.columns = [
+            ('col1', TD_INTEGER, 4, 0, 0),
+            ('col2', TD_VARCHAR, 50, 0, 0),
+        ]
+        data = b""
+        for row in [(1, "a"), (2, "bcd")]:
+            packed = encoder.serialize(row)
+            data += struct.pack("H", len(packed)) + packed
+        assert encoder.read_at(data, 1) == (2, "bcd")
+        with pytest.raises(EncoderError):
+            encoder.readcolumn(data, 0)
+
+    def test_null_indicators(self, encoder):
+        """
+        Ensure null indicators are read correctly across multiple header
+        bytes, and for rows without any nulls
+        """
+        encoder.columns = [("col{}".format(i), TD_INTEGER, 4, 0, 0) for i in range(20)]
+        rows = [
+            tuple(range(20)),
+            tuple(None if i in (0, 7, 8, 19) else i for i in range(20)),
+            tuple(None for i in range(20)),
+        ]
+        encoder |= ROW_ENCODING_LIST
+        for row in rows:
+            assert encoder.read(encoder.serialize(row)) == row
+
+    def test_format_integers(self, encoder):
+        """
+        Ensure integer and date values are formatted correctly at the
+        limits of each type when encoding to a string
+        """
+        encoder.columns = [
+            ('col1', TD_BYTEINT, 1, 0, 0),
+            ('col2', TD_SMALLINT, 2, 0, 0),
+            ('col3', TD_INTEGER, 4, 0, 0),
+            ('col4', TD_BIGINT, 8, 0, 0),
+            ('col5', TD_DATE, 4, 0, 0),
+        ]
+        rows = [
+            (-128, -32768, -2147483648, -9223372036854775808, "0001-01-01"),
+            (127, 32767, 2147483647, 9223372036854775807, "9999-12-31"),
+            (0, 9, 10, 99, "1900-01-01"),
+            (-1, -10, 100, -101, "1899-12-31"),
+        ]
+        data = [encoder.serialize(row) for row in rows]
+        encoder |= ENCODER_SETTINGS_STRING
+        for row, packed in zip(rows, data):
+            assert encoder.read(packed) == "|".join(str(v) for v in row)
+
+        # DATE values outside of 0000-9999 are cut to 10 characters
+        encoder.columns = [('col1', TD_DATE, 4, 0, 0)]
+        for value, expected in [(-30000000, "-1100-00-0"), (2000000000, "201900-00-")]:
+            packed = b'\x00' + struct.pack("<i", value)
+            encoder |= ENCODER_SETTINGS_STRING
+            assert encoder.read(packed) == expected
+            encoder |= ROW_ENCODING_LIST
+            assert encoder.read(packed) == (expected,)
+
+    def test_format_floats(self, encoder):
+        """
+        Ensure floats are written with the shortest representation that
+        round-trips when encoding to a string
+        """
+        encoder.columns = [('col1', TD_FLOAT, 8, 0, 0)]
+        expected = [
+            (0.0, "0"),
+            (-0.0, "-0"),
+            (1.0, "1"),
+            (0.1, "0.1"),
+            (-3.2, "-3.2"),
+            (0.0001, "0.0001"),
+            (1e-05, "1e-05"),
+            (1e15, "1000000000000000"),
+            (1e16, "1e+16"),
+            (5e-324, "5e-324"),
+            (1.7976931348623157e308, "1.7976931348623157e+308"),
+            (float("inf"), "inf"),
+            (float("-inf"), "-inf"),
+        ]
+        rand = random.Random(42)
+        values = [rand.uniform(-1e6, 1e6) for i in range(1000)]
+        values += [struct.unpack("d", struct.pack("Q", rand.getrandbits(62)))[0] for i in range(1000)]
+        data = [encoder.serialize((v,)) for v, _ in expected] + [encoder.serialize((v,)) for v in values]
+        encoder |= ENCODER_SETTINGS_STRING
+        for (v, s), packed in zip(expected, data):
+            assert encoder.read(packed) == s
+        for v, packed in zip(values, data[len(expected):]):
+            assert float(encoder.read(packed)) == v
+
+    def test_decimal_as_float(self):
+        """
+        Ensure decimals converted directly to float are identical to
+        parsing the string representation of the decimal
+        """
+        rand = random.Random(7)
+        for size, precision in [(1, 2), (2, 4), (4, 9), (8, 18), (16, 38)]:
+            for scale in range(precision + 1):
+                columns = Columns([('col1', DECIMAL_NN, size, precision, scale)])
+                as_float = giraffez.Encoder(columns, DECIMAL_AS_FLOAT)
+                as_string = giraffez.Encoder(columns, DECIMAL_AS_STRING)
+                bits = size * 8
+                for i in range(50):
+                    value = rand.getrandbits(rand.randint(1, bits - 1)) * rand.choice([1, -1])
+                    data = b'\x00' + bytes(bytearray((value >> (8*j)) & 0xff for j in range(size)))
+                    assert as_float.read(data)[0] == float(as_string.read(data)[0])
+        columns = Columns([('col1', NUMBER_NN, 18, 38, 0)])
+        as_float = giraffez.Encoder(columns, DECIMAL_AS_FLOAT)
+        as_string = giraffez.Encoder(columns, DECIMAL_AS_STRING)
+        for i in range(500):
+            length = rand.randint(1, 16)
+            value = rand.getrandbits(length * 8 - 1) * rand.choice([1, -1])
+            data = b'\x00' + struct.pack("<bh", length + 2, rand.randint(-10, 38)) + \
+                bytes(bytearray((value >> (8*j)) & 0xff for j in range(length)))
+            assert as_float.read(data)[0] == float(as_string.read(data)[0])
+        assert as_float.read(b'\x00\x00')[0] == 0.0
+
+    def test_decimal_as_giraffez_decimal(self):
+        """
+        Ensure decimals built from the binary value are giraffez Decimals
+        identical to parsing the string representation of the decimal
+        """
+        rand = random.Random(7)
+        for size, precision in [(1, 2), (2, 4), (4, 9), (8, 18), (16, 38)]:
+            for scale in range(precision + 1):
+                columns = Columns([('col1', DECIMAL_NN, size, precision, scale)])
+                as_decimal = giraffez.Encoder(columns, DECIMAL_AS_GIRAFFEZ_DECIMAL)
+                as_string = giraffez.Encoder(columns, DECIMAL_AS_STRING)
+                bits = size * 8
+                for i in range(50):
+                    value = rand.getrandbits(rand.randint(1, bits - 1)) * rand.choice([1, -1])
+                    data = b'\x00' + bytes(bytearray((value >> (8*j)) & 0xff for j in range(size)))
+                    result = as_decimal.read(data)[0]
+                    assert type(result) is giraffez.types.Decimal
+                    assert str(result) == str(decimal.Decimal(as_string.read(data)[0]))
+        columns = Columns([('col1', NUMBER_NN, 18, 38, 0)])
+        as_decimal = giraffez.Encoder(columns, DECIMAL_AS_GIRAFFEZ_DECIMAL)
+        as_string = giraffez.Encoder(columns, DECIMAL_AS_STRING)
+        for i in range(500):
+            length = rand.randint(1, 16)
+            value = rand.getrandbits(length * 8 - 1) * rand.choice([1, -1])
+            data = b'\x00' + struct.pack("<bh", length + 2, rand.randint(-10, 38)) + \
+                bytes(bytearray((value >> (8*j)) & 0xff for j in range(length)))
+            result = as_decimal.read(data)[0]
+            assert type(result) is giraffez.types.Decimal
+            assert str(result) == str(decimal.Decimal(as_string.read(data)[0]))
+        assert as_decimal.read(b"\x00\x00")[0] == 0
+
+    def test_decimal_as_scaled_int(self):
+        """
+        Ensure decimals are returned as their unscaled integer value and
+        NUMBER values are rescaled to the scale of their column
+        """
+        rand = random.Random(7)
+        for size, precision in [(1, 2), (2, 4), (4, 9), (8, 18), (16, 38)]:
+            for scale in range(0, precision + 1, 3):
+                columns = Columns([('col1', DECIMAL_NN, size, precision, scale)])
+                as_int = giraffez.Encoder(columns, DECIMAL_AS_SCALED_INT)
+                as_string = giraffez.Encoder(columns, DECIMAL_AS_STRING)
+                bits = size * 8
+                for i in range(50):
+                    value = rand.getrandbits(rand.randint(1, bits - 1)) * rand.choice([1, -1])
+                    data = b'\x00' + bytes(bytearray((value >> (8*j)) & 0xff for j in range(size)))
+                    result = as_int.read(data)[0]
+                    assert type(result) is int
+                    assert result == value
+                    assert result == int(as_string.read(data)[0].replace(".", ""))
+        columns = Columns([('col1', NUMBER_NN, 18, 38, 4)])
+        encoder = giraffez.Encoder(columns, DECIMAL_AS_SCALED_INT)
+        number = lambda value, scale: b'\x00' + struct.pack("<bhq", 10, scale, value)
+        assert encoder.read(number(12345, 2))[0] == 1234500
+        assert encoder.read(number(-12345, 4))[0] == -12345
+        assert encoder.read(number(12, -30))[0] == 12 * 10**34
+        assert encoder.read(number(1234500, 6))[0] == 12345
+        assert encoder.read(b'\x00\x00')[0] == 0
+        with pytest.raises(EncoderError):
+            encoder.read(number(1234567, 6))
+
+    def test_decimal_limits(self):
+        """
+        Ensure the extremes of DECIMAL(38) and NUMBER decode exactly in
+        every decimal mode
+        """
+        to_bytes = lambda value, size: bytes(bytearray((value >> (8*j)) & 0xff for j in range(size)))
+        largest = 10**38 - 1
+        decimals = [
+            (38, 0, largest), (38, 0, -largest), (38, 10, largest), (38, 10, -largest),
+            (38, 0, -2**63), (38, 0, -2**63 - 1), (38, 0, -2**64), (38, 0, -2**64 + 1),
+            (38, 38, -largest),
+        ]
+        for precision, scale, value in decimals:
+            columns = Columns([('col1', DECIMAL_NN, 16, precision, scale)])
+            data = b'\x00' + to_bytes(value, 16)
+            expected = decimal.Decimal("%de%d" % (value, -scale))
+            assert decimal.Decimal(giraffez.Encoder(columns, DECIMAL_AS_STRING).read(data)[0]) == expected
+            assert giraffez.Encoder(columns, DECIMAL_AS_FLOAT).read(data)[0] == float(expected)
+            assert giraffez.Encoder(columns, DECIMAL_AS_GIRAFFEZ_DECIMAL).read(data)[0] == expected
+            assert giraffez.Encoder(columns, DECIMAL_AS_SCALED_INT).read(data)[0] == value
+        numbers = [
+            (5, -3), (-123, -2), (1, 38), (-largest, 38), (largest, 0),
+            (-2**127, 0), (2**127 - 1, 0), (-2**127, 20),
+        ]
+        columns = Columns([('col1', NUMBER_NN, 18, 38, 0)])
+        for value, scale in numbers:
+            data = b'\x00' + struct.pack("<bh", 18, scale) + to_bytes(value, 16)
+            expected = decimal.Decimal("%de%d" % (value, -scale))
+            assert decimal.Decimal(giraffez.Encoder(columns, DECIMAL_AS_STRING).read(data)[0]) == expected
+            assert giraffez.Encoder(columns, DECIMAL_AS_FLOAT).read(data)[0] == float(expected)
+            assert giraffez.Encoder(columns, DECIMAL_AS_GIRAFFEZ_DECIMAL).read(data)[0] == expected
+            if scale <= 0:
+                assert giraffez.Encoder(columns, DECIMAL_AS_SCALED_INT).read(data)[0] == expected
+        # a NUMBER longer than 16 bytes is malformed and must not overrun
+        # the value, the following column is still found at the right offset
+        columns = Columns([('col1', NUMBER_NN, 18, 38, 0), ('col2', INTEGER_NN, 4, 0, 0)])
+        data = b'\x00' + struct.pack("<bh", 20, 0) + b'\x01' * 18 + struct.pack("<i", 7)
+        assert giraffez.Encoder(columns, DECIMAL_AS_STRING).read(data)[1] == 7
+        # a scale outside the range of NUMBER is rejected in every mode
+        columns = Columns([('col1', NUMBER_NN, 18, 38, 0)])
+        for scale in (-1000, -126, 168, 32767):
+            data = b'\x00' + struct.pack("<bh", 18, scale) + to_bytes(1, 16)
+            for mode in (DECIMAL_AS_STRING, DECIMAL_AS_FLOAT, DECIMAL_AS_GIRAFFEZ_DECIMAL, DECIMAL_AS_SCALED_INT):
+                with pytest.raises(EncoderError):
+                    giraffez.Encoder(columns, mode).read(data)
+
+    def test_pack_decimal(self):
+        """
+        Ensure decimal text is packed at the scale of the column, rounding
+        half to even, and that values outside the range of the column
+        or NUMBER are rejected
+        """
+        rand = random.Random(11)
+        for size, precision in [(1, 2), (2, 4), (4, 9), (8, 18), (16, 38)]:
+            for scale in range(0, precision + 1, 3):
+                columns = Columns([('col1', DECIMAL_NN, size, precision, scale)])
+                encoder = giraffez.Encoder(columns, DECIMAL_AS_SCALED_INT)
+                bits = size * 8
+                text = lambda value: str(decimal.Decimal(value).scaleb(-scale, decimal.Context(prec=50)))
+                for i in range(50):
+                    value = rand.getrandbits(rand.randint(1, bits - 1)) * rand.choice([1, -1])
+                    assert encoder.read(encoder.serialize([text(value)]))[0] == value
+                with pytest.raises(EncoderError):
+                    encoder.serialize([text(2**(bits-1))])
+                assert encoder.read(encoder.serialize([text(-2**(bits-1))]))[0] == -2**(bits-1)
+        columns = Columns([('col1', DECIMAL_NN, 8, 18, 2)])
+        encoder = giraffez.Encoder(columns, DECIMAL_AS_SCALED_INT)
+        values = ["1.005", "1.015", "1.0051", "-1.005", "-1.015", "0.004", "12", " 12.5 ", "+1e2",
+            "1.5E-1", decimal.Decimal("3.14159"), 7, 0.25]
+        expected = [100, 102, 101, -100, -102, 0, 1200, 1250, 10000, 15, 314, 700, 25]
+        assert [encoder.read(encoder.serialize([v]))[0] for v in values] == expected
+        for value in ["", "-", ".", "1.2.3", "1e", "12a", "abc", "inf"]:
+            with pytest.raises(EncoderError):
+                encoder.serialize([value])
+        columns = Columns([('col1', NUMBER_NN, 16, 38, 0), ('col2', INTEGER_NN, 4, 0, 0)])
+        encoder = giraffez.Encoder(columns, DECIMAL_AS_STRING)
+        for value in ["0", "1", "127", "128", "-128", "-129", "255", "4294967296", "-4294967297",
+                "12.50", "-0.001", "123456789012345678901234567890", str(-2**127)]:
+            data = encoder.serialize([value, 42])
+            assert encoder.read(data) == (value, 42)
+        assert encoder.serialize(["128", 42]) == b"\x00\x04\x00\x00\x80\x00*\x00\x00\x00"
+        assert encoder.read(encoder.serialize(["1E+3", 42])) == ("1000", 42)
+        with pytest.raises(EncoderError):
+            encoder.serialize([str(2**127), 42])
+
+    def test_date_cache(self):
+        """
+        Ensure repeated dates share one object and that dates evicted from
+        the cache are still converted correctly
+        """
+        columns = Columns([('col1', DATE_NN, 4, 0, 0), ('col2', DATE_NN, 4, 0, 0)])
+        encoder = giraffez.Encoder(columns)
+        start = datetime.date(1850, 6, 22)
+        dates = [start + datetime.timedelta(days=i * 7) for i in range(3000)]
+        data = b""
+        for d in dates:
+            row = encoder.serialize([str(d), str(dates[0])])
+            data += struct.pack("H", len(row)) + row
+        repeated = b""
+        for i in range(100):
+            row = encoder.serialize(["2015-11-{}".format(15 + i % 3), "2015-11-15"])
+            repeated += struct.pack("H", len(row)) + row
+        encoder |= ROW_ENCODING_LIST
+        for encoding in [DATETIME_AS_STRING, DATETIME_AS_GIRAFFE_TYPES]:
+            encoder |= encoding
+            for i in range(2):
+                rows = encoder.readbuffer(data)
+                assert len(rows) == len(dates)
+                for d, row in zip(dates, rows):
+                    if encoding == DATETIME_AS_GIRAFFE_TYPES:
+                        row = ["{:04d}-{:02d}-{:02d}".format(v.year, v.month, v.day) for v in row]
+                    assert row[0] == str(d)
+                    assert row[1] == str(dates[0])
+            rows = encoder.readbuffer(repeated)
+            assert len(set(id(value) for row in rows for value in row)) == 3
+
+    def test_pack_dates(self):
+        """
+        Ensure dates are packed from each supported format, with the format
+        of a column detected from its first value, and that times and
+        timestamps are written in the layout of their column
+        """
+        formats = [
+            ["2015-01-09", "1999-12-31", "1900-1-1", "2016/02/29"],
+            ["20150109", "19991231", "19000101", "20160229"],
+            ["01/09/2015", "12/31/1999", "1/1/1900", "02/29/2016"],
+            ["1150109", "991231", "101", 1160229],
+        ]
+        expected = (u"2015-01-09", u"1999-12-31", u"1900-01-01", u"2016-02-29")
+        for values in formats:
+            encoder = giraffez.Encoder(Columns([("col1", DATE_NN, 4, 0, 0)]))
+            assert tuple(encoder.read(encoder.serialize([v]))[0] for v in values) == expected
+        encoder = giraffez.Encoder(Columns([("col1", DATE_NN, 4, 0, 0)]))
+        assert encoder.read(encoder.serialize([datetime.date(1850, 7, 4)])) == (u"1850-07-04",)
+        encoder = giraffez.Encoder(Columns([("col1", DATE_NN, 4, 0, 0)]))
+        assert encoder.read(encoder.serialize(["-499296"])) == (u"1850-07-04",)
+        for values in formats:
+            encoder = giraffez.Encoder(Columns([("col1", DATE_NN, 4, 0, 0)]))
+            encoder.serialize([values[0]])
+            for other in formats:
+                if other is not values and not isinstance(other[0], int):
+                    with pytest.raises(EncoderError):
+                        encoder.serialize([other[1]])
+        for value in ["2015-02-29", "2015-13-01", "20151301", "13/01/2015", "abc", "", "1151301"]:
+            encoder = giraffez.Encoder(Columns([("col1", DATE_NN, 4, 0, 0)]))
+            with pytest.raises(EncoderError):
+                encoder.serialize([value])
+        columns = Columns([
+            ("col1", TIME_NN, 8, 0, 0),
+            ("col2", TIME_NN, 15, 0, 0),
+            ("col3", TIMESTAMP_NN, 19, 0, 0),
+            ("col4", TIMESTAMP_NN, 26, 0, 0),
+            ("col5", TIMESTAMP_NN, 22, 0, 0),
+        ])
+        encoder = giraffez.Encoder(columns)
+        rows = [
+            (("12:34:56", "1:02:03.5", "2015-01-09 12:34:56", "2015-01-09T12:34:56.123456", "2015-01-09"),
+             (u"12:34:56", u"01:02:03.500000", u"2015-01-09 12:34:56", u"2015-01-09 12:34:56.123456",
+              u"2015-01-09 00:00:00.00")),
+            (("23:59", "12:00:00", "2016-02-29 00:00:00.000", "2016-02-29 00:00:00", "2016-02-29 01:02:03.4"),
+             (u"23:59:00", u"12:00:00.000000", u"2016-02-29 00:00:00", u"2016-02-29 00:00:00.000000",
+              u"2016-02-29 01:02:03.40")),
+            ((datetime.time(1, 2, 3), datetime.time(1, 2, 3, 456), datetime.datetime(2015, 1, 9, 1, 2, 3),
+              datetime.datetime(2015, 1, 9, 1, 2, 3, 456789), "2015-01-09 01:02:03.120000"),
+             (u"01:02:03", u"01:02:03.000456", u"2015-01-09 01:02:03", u"2015-01-09 01:02:03.456789",
+              u"2015-01-09 01:02:03.12")),
+        ]
+        for values, expected in rows:
+            assert encoder.read(encoder.serialize(values)) == expected
+        for values in [
+                ("12:34:56.1", "12:00:00", "2015-01-09", "2015-01-09", "2015-01-09"),
+                ("12:00:00", "12:00:00", "2015-01-09 12:00:00.5", "2015-01-09", "2015-01-09"),
+                ("12:00:00", "12:00:00", "2015-01-09", "2015-01-09", "2015-01-09 12:00:00.123")]:
+            with pytest.raises(EncoderError):
+                encoder.serialize(values)
+        # Values that cannot be parsed are copied as text, as they were
+        # before they were parsed, and fail if they do not fit the column
+        values = ("24:00:00", "12:00:00", "09.01.2015 12:00:00", "2015-01-09 12:00:00+00:00", "1150109")
+        assert encoder.read(encoder.serialize(values)) == \
+            (u"24:00:00", u"12:00:00.000000", u"09.01.2015 12:00:00", u"2015-01-09 12:00:00+00:00 ",
+             u"1150109" + u" " * 15)
+        with pytest.raises(EncoderError):
+            encoder.serialize(("12:00:00", "12:00:00", "2015-01-09 12:00:00+00:00", "2015-01-09", "2015-01-09"))
+
+    def test_pack_native_types(self):
+        """
+        Ensure date, time, datetime and int values are packed from their
+        fields, giving the same result as their text, and that None is
+        only matched as null by identity
+        """
+        class DateSubclass(datetime.date):
+            pass
+        encoder = giraffez.Encoder(Columns([("col1", DATE_NN, 4, 0, 0)]))
+        for value in [datetime.date(2015, 1, 9), datetime.datetime(2015, 1, 9, 23, 59), DateSubclass(2015, 1, 9)]:
+            assert encoder.read(encoder.serialize([value])) == (u"2015-01-09",)
+        # a date object does not decide the format of later text values
+        assert encoder.read(encoder.serialize(["01/09/2015"])) == (u"2015-01-09",)
+        columns = Columns([
+            ("col1", TIME_NN, 8, 0, 0),
+            ("col2", TIME_NN, 15, 0, 0),
+            ("col3", TIMESTAMP_NN, 19, 0, 0),
+            ("col4", TIMESTAMP_NN, 26, 0, 0),
+        ])
+        encoder = giraffez.Encoder(columns)
+        values = (datetime.time(23, 59, 58), datetime.time(0, 0, 0, 1), datetime.date(2016, 2, 29),
+            datetime.datetime(1900, 1, 1, 0, 0, 0, 500000))
+        expected = (u"23:59:58", u"00:00:00.000001", u"2016-02-29 00:00:00", u"1900-01-01 00:00:00.500000")
+        assert encoder.read(encoder.serialize(values)) == expected
+        assert encoder.serialize(values) == encoder.serialize([str(v) for v in values])
+        invalid = [
+            (datetime.time(0, 0, 0, 1),) + values[1:],
+            values[:2] + (datetime.datetime(2015, 1, 9, 0, 0, 0, 1),) + values[3:],
+        ]
+        for row in invalid:
+            with pytest.raises(EncoderError):
+                encoder.serialize(row)
+        # aware datetimes are copied as their text
+        if hasattr(datetime, "timezone"):
+            row = values[:3] + (datetime.datetime(2015, 1, 9, tzinfo=datetime.timezone.utc),)
+            assert encoder.read(encoder.serialize(row))[3] == u"2015-01-09 00:00:00+00:00 "
+        columns = Columns([
+            ("col1", DECIMAL_NN, 8, 18, 2),
+            ("col2", DECIMAL_NN, 16, 38, 4),
+            ("col3", NUMBER_NN, 16, 38, 0),
+        ])
+        encoder = giraffez.Encoder(columns, DECIMAL_AS_STRING)
+        for row in [(0, 0, 0), (-7, 2**64, -2**70), (2**63 // 100, -2**63, 2**64 - 1)]:
+            assert encoder.serialize(row) == encoder.serialize([str(v) for v in row])
+        assert encoder.read(encoder.serialize((12, -3, 255))) == (u"12.00", u"-3.0000", u"255")
+        assert encoder.read(encoder.serialize((decimal.Decimal("1.005"), 1, 0))) == \
+            (u"1.00", u"1.0000", u"0")
+        with pytest.raises(EncoderError):
+            encoder.serialize((2**63 // 100 + 1, 0, 0))
+        with pytest.raises(EncoderError):
+            encoder.serialize((0, 0, 2**127))
+
+        class AlwaysEqual(object):
+            def __eq__(self, other):
+                return True
+            def __str__(self):
+                return "5"
+        encoder = giraffez.Encoder(Columns([("col1", DECIMAL_N, 8, 18, 0)]), DECIMAL_AS_STRING)
+        assert encoder.read(encoder.serialize([AlwaysEqual()])) == (u"5",)
+        encoder.null = "NULL"
+        assert encoder.read(encoder.serialize([AlwaysEqual()])) == ("NULL",)
+
+    def test_char_format_invalid_utf8(self):
+        """
+        Ensure invalid UTF-8 in a CHAR column with a FORMAT raises the
+        decode error instead of crashing
+        """
+        encoder = giraffez.Encoder(Columns([("col1", TD_CHAR, 8, 0, 0, "N", None, "X(6)")]))
+        with pytest.raises(UnicodeDecodeError):
+            encoder.read(b"\x00\xffTEST   ")
+
+    def test_charset(self):
+        """
+        Ensure strings are decoded and encoded in the session charset, with
+        and without the ASCII fast path
+        """
+        columns = Columns([
+            ("col1", TD_CHAR, 8, 0, 0, "N", None, "X(6)"),
+            ("col2", VARCHAR_NN, 50, 0, 0),
+        ])
+        values = [u"TEST  ", u"plain ascii value of more than 16 bytes"]
+        for charset, word in [("UTF8", b'caf\xc3\xa9'), ("latin1", b'caf\xe9')]:
+            encoder = giraffez.Encoder(columns, charset=charset)
+            data = encoder.serialize([u"caf\xe9", u"caf\xe9" * 20])
+            assert data == b'\x00' + word + b' ' * (8 - len(word)) + \
+                struct.pack("<H", len(word) * 20) + word * 20
+            assert encoder.read(data) == (u"caf\xe9  ", u"caf\xe9" * 20)
+            data = encoder.serialize(values)
+            assert encoder.read(data) == tuple(values)
+            encoder |= ENCODER_SETTINGS_STRING
+            assert encoder.read(data) == u"TEST    |" + values[1]
+            # the delimiter and null strings are written in the charset
+            data = encoder.serialize([None, u"caf\xe9"])
+            encoder |= ENCODER_SETTINGS_STRING
+            encoder.delimiter = u"\xa7"
+            encoder.null = u"\xf8"
+            assert encoder.read(data) == u"\xf8\xa7caf\xe9"
+        with pytest.raises(UnicodeEncodeError):
+            giraffez.Encoder(columns, charset="LATIN1").delimiter = u"\u20ac"
+        with pytest.raises(ValueError):
+            giraffez.Encoder(columns, charset="EBCDIC")
+        with pytest.raises(UnicodeEncodeError):
+            giraffez.Encoder(columns, charset="LATIN1").serialize([u"\u20ac", u""])
+        with pytest.raises(UnicodeDecodeError):
+            giraffez.Encoder(columns).read(b'\x00' + b' ' * 8 + b'\x01\x00\xff')
+
+    def test_trim_char(self):
+        """
+        Ensure STRING_TRIM_CHAR removes the padding of CHAR values in every
+        encoding and charset, leaving VARCHAR values untouched
+        """
+        columns = Columns([
+            ("col1", TD_CHAR, 24, 0, 0, "N", None, "X(8)"),
+            ("col2", CHAR_NN, 40, 0, 0),
+            ("col3", VARCHAR_NN, 50, 0, 0),
+        ])
+        for charset, word in [("UTF8", u"caf\xe9"), ("LATIN1", u"caf\xe9")]:
+            encoder = giraffez.Encoder(columns, charset=charset)
+            for i in range(41):
+                for value in [u"x" * i, u" " * i, (u"a b " * 10)[:i], word + u" " * (i % 8)]:
+                    data = encoder.serialize([value[:8], value, value])
+                    encoder |= ENCODER_SETTINGS_DEFAULT
+                    encoder |= STRING_TRIM_CHAR
+                    assert encoder.read(data) == (value[:8].rstrip(" "), value.rstrip(" "), value)
+                    encoder |= STRING_AS_INTERNED | STRING_TRIM_CHAR
+                    assert encoder.read(data) == (value[:8].rstrip(" "), value.rstrip(" "), value)
+                    encoder |= ENCODER_SETTINGS_STRING
+                    encoder |= STRING_TRIM_CHAR
+                    assert encoder.read(data) == u"|".join([value[:8].rstrip(" "), value.rstrip(" "), value])
+                    encoder |= STRING_AS_NEW
+                    encoder |= ROW_ENCODING_LIST
+                    padded = encoder.read(data)[1]
+                    assert len(padded) >= 39 and padded.rstrip(" ") == value.rstrip(" ")
+        # Values longer than the format are truncated before being trimmed
+        for charset in ["UTF8", "LATIN1"]:
+            encoder = giraffez.Encoder(columns, encoding=ENCODER_SETTINGS_DEFAULT | STRING_TRIM_CHAR,
+                charset=charset)
+            for value in [u"abcdefg xyz", u"abcd    xyz", u"caf\xe9    xyz", u"caf\xe9 d\xe9j\xe0 xyz"]:
+                data = encoder.serialize([value, u"", u""])
+                assert encoder.read(data) == (value[:8].rstrip(" "), u"", u"")
+
+    def test_time_giraffe_types(self):
+        """
+        Ensure TIME/TIMESTAMP values keep their fractional seconds, and
+        values not in the Teradata layout are returned as strings
+        """
+        columns = Columns([
+            ("col1", TIME_NN, 8, 0, 0),
+            ("col2", TIME_NN, 15, 0, 0),
+            ("col3", TIME_NN, 12, 0, 0),
+            ("col4", TIMESTAMP_NN, 19, 0, 0),
+            ("col5", TIMESTAMP_NN, 26, 0, 0),
+            ("col6", TIMESTAMP_NN, 22, 0, 0),
+            ("col7", TIMESTAMP_NN, 19, 0, 0),
+        ])
+        encoder = giraffez.Encoder(columns, encoding=ROW_ENCODING_LIST | DATETIME_AS_GIRAFFE_TYPES | DECIMAL_AS_STRING)
+        data = (b'\x00' + b'10:12:55' + b'23:59:59.123456' + b'01:02:03.120' + b'2015-11-15 10:12:55'
+            + b'1850-06-22 00:00:01.000001' + b'2015-11-15 10:12:55.12' + b'2015-13-01 10:12:55')
+        row = encoder.read(data)
+        assert row[0] == datetime.time(10, 12, 55)
+        assert row[1] == datetime.time(23, 59, 59, 123456)
+        assert row[2] == datetime.time(1, 2, 3, 120000)
+        assert row[3] == datetime.datetime(2015, 11, 15, 10, 12, 55)
+        assert row[4] == datetime.datetime(1850, 6, 22, 0, 0, 1, 1)
+        assert row[5] == datetime.datetime(2015, 11, 15, 10, 12, 55, 120000)
+        assert row[5].to_string() == "2015-11-15 10:12:55.12"
+        assert row[6] == "2015-13-01 10:12:55"
+        assert isinstance(row[1], giraffez.types.Time) and isinstance(row[4], giraffez.types.Timestamp)
+
+    def test_pydatetime(self):
+        """
+        Ensure DATETIME_AS_PYDATETIME returns the datetime types themselves
+        """
+        columns = Columns([
+            ("col1", DATE_NN, 4, 0, 0),
+            ("col2", TIME_NN, 15, 0, 0),
+            ("col3", TIMESTAMP_NN, 26, 0, 0),
+            ("col4", TIMESTAMP_NN, 19, 0, 0),
+        ])
+        encoder = giraffez.Encoder(columns, encoding=ROW_ENCODING_LIST | DATETIME_AS_PYDATETIME | DECIMAL_AS_STRING)
+        data = (b'\x00' + b'\x8b\x90\x11\x00' + b'23:59:59.123456' + b'1850-06-22 00:00:01.000001'
+            + b'2015-11-15 25:12:55')
+        row = encoder.read(data)
+        assert type(row[0]) is datetime.date and row[0] == datetime.date(2015, 11, 15)
+        assert type(row[1]) is datetime.time and row[1] == datetime.time(23, 59, 59, 123456)
+        assert type(row[2]) is datetime.datetime and row[2] == datetime.datetime(1850, 6, 22, 0, 0, 1, 1)
+        assert row[3] == "2015-11-15 25:12:55"
+
+    def test_epoch(self):
+        """
+        Ensure DATETIME_AS_EPOCH returns days and microseconds since the
+        epoch (in UTC) for rows, columnar buffers and Arrow arrays
+        """
+        columns = Columns([
+            ("col1", DATE_NN, 4, 0, 0),
+            ("col2", TIME_NN, 15, 0, 0),
+            ("col3", TIMESTAMP_NN, 26, 0, 0),
+            ("col4", TIME_NNZ, 14, 0, 0),
+            ("col5", TIMESTAMP_NNZ, 25, 0, 0),
+        ])
+        encoder = giraffez.Encoder(columns, encoding=ROW_ENCODING_LIST | DATETIME_AS_EPOCH | DECIMAL_AS_STRING)
+        row = (b'\x00' + b'\x8b\x90\x11\x00' + b'23:59:59.123456' + b'1850-06-22 00:00:01.000001'
+            + b'01:30:00-05:00' + b'2015-11-15 22:30:00+02:00')
+        epoch = datetime.datetime(1970, 1, 1)
+        expected = [
+            (datetime.date(2015, 11, 15) - epoch.date()).days,
+            ((23 * 60 + 59) * 60 + 59) * 10**6 + 123456,
+            (datetime.datetime(1850, 6, 22, 0, 0, 1, 1) - epoch) // datetime.timedelta(microseconds=1),
+            (6 * 60 + 30) * 60 * 10**6,
+            (datetime.datetime(2015, 11, 15, 20, 30) - epoch) // datetime.timedelta(microseconds=1),
+        ]
+        assert list(encoder.read(row)) == expected
+        assert encoder.read(row[:-25] + b'2015-11-15 25:12:55      ')[4] == "2015-11-15 25:12:55      "
+        # WITH TIME ZONE values are strings in every other setting, and
+        # are packed as the text they are given
+        for settings in [DATETIME_AS_STRING, DATETIME_AS_GIRAFFE_TYPES, DATETIME_AS_PYDATETIME]:
+            encoder |= settings
+            assert encoder.read(row)[3:] == ("01:30:00-05:00", "2015-11-15 22:30:00+02:00")
+        assert encoder.serialize(encoder.read(row)) == row
+        encoder |= DATETIME_AS_EPOCH
+
+        data = struct.pack("H", len(row)) + row
+        encoder |= ROW_ENCODING_COLUMNAR
+        result = encoder.readbuffer(data * 2)
+        for name, value in zip(columns.names, expected):
+            assert memoryview(result[name]).format == "q"
+            assert memoryview(result[name]).tolist() == [value, value]
+        bad = row[:-25] + b'2015-11-15 25:12:55      '
+        with pytest.raises(EncoderError):
+            encoder.readbuffer(struct.pack("H", len(bad)) + bad)
+        np = pytest.importorskip("numpy")
+        assert np.frombuffer(result["col1"], dtype="datetime64[D]")[0] == np.datetime64("2015-11-15")
+        assert np.frombuffer(result["col3"], dtype="datetime64[us]")[0] == \
+            np.datetime64("1850-06-22T00:00:01.000001")
+
+        pa = pytest.importorskip("pyarrow")
+        result = pa.record_batch(encoder.readbuffer_arrow(data))
+        assert [str(f.type) for f in result.schema] == \
+            ["date32[day]", "time64[us]", "timestamp[us]", "time64[us]", "timestamp[us, tz=UTC]"]
+        assert result.to_pylist()[0]["col5"].replace(tzinfo=None) == datetime.datetime(2015, 11, 15, 20, 30)
+        assert result.to_pylist()[0]["col5"].utcoffset() == datetime.timedelta(0)
+
+    def test_intern_strings(self):
+        """
+        Ensure interned columns share objects between repeated values, and
+        that high-cardinality and long values are still decoded correctly
+        """
+        columns = Columns([
+            ("col1", CHAR_NN, 2, 0, 0),
+            ("col2", VARCHAR_NN, 20, 0, 0),
+            ("col3", VARCHAR_NN, 100, 0, 0),
+        ])
+        encoder = giraffez.Encoder(columns)
+        codes = [u"VA", u"MD", u"DC"]
+        expected = [(codes[i % 3], u"value{}".format(i), u"x" * 80) for i in range(10000)]
+        data = b""
+        for values in expected:
+            row = encoder.serialize(values)
+            data += struct.pack("H", len(row)) + row
+        encoder |= ROW_ENCODING_LIST
+        encoder |= STRING_AS_INTERNED
+        for i in range(2):
+            rows = encoder.readbuffer(data)
+            assert rows == expected
+            assert len(set(id(row[0]) for row in rows)) == 3
+            assert len(set(id(row[2]) for row in rows)) == len(rows)
+        encoder |= STRING_AS_NEW
+        rows = encoder.readbuffer(data)
+        assert rows == expected
+        assert len(set(id(row[0]) for row in rows)) == len(rows)
+
+    def test_recompile(self):
+        """
+        Ensure changing the settings keeps the caches that still apply, and
+        that a failed change leaves the encoder as it was
+        """
+        columns = Columns([
+            ("col1", VARCHAR_NN, 20, 0, 0),
+            ("col2", DATE_NN, 4, 0, 0),
+        ])
+        encoder = giraffez.Encoder(columns)
+        data = encoder.serialize((u"VA", u"2015-01-09"))
+        encoder |= ROW_ENCODING_LIST
+        encoder |= STRING_AS_INTERNED
+        encoder |= DATETIME_AS_GIRAFFE_TYPES
+        row = encoder.read(data)
+        encoder |= ROW_ENCODING_DICT
+        assert encoder.read(data)["col1"] is row[0]
+        assert encoder.read(data)["col2"] is row[1]
+        encoder |= DATETIME_AS_STRING
+        assert encoder.read(data) == {"col1": u"VA", "col2": u"2015-01-09"}
+        encoder |= ROW_ENCODING_LIST
+        with pytest.raises(ValueError):
+            encoder.encoder.set_encoding(ROW_ENCODING_DICT | DATETIME_AS_STRING | 0x00090000)
+        assert encoder.read(data) == (u"VA", u"2015-01-09")
+
+    def test_record(self):
+        """
+        Ensure records support the access patterns of giraffez.Row and are
+        serialized like the other row encodings
+        """
+        columns = Columns([
+            ("col1", INTEGER_NN, 4, 0, 0),
+            ("Col 2", VARCHAR_N, 20, 0, 0),
+            ("col3", VARCHAR_N, 20, 0, 0),
+        ])
+        encoder = giraffez.Encoder(columns)
+        data = b""
+        for values in [(1, u"value1", None), (2, u"value2", u"value3")]:
+            row = encoder.serialize(values)
+            data += struct.pack("H", len(row)) + row
+        encoder |= ROW_ENCODING_RECORD
+        rows = encoder.readbuffer(data)
+        row = rows[1]
+        assert len(row) == 3
+        assert list(row) == [2, u"value2", u"value3"]
+        assert (row[0], row[-1]) == (2, u"value3")
+        assert row[1:] == (u"value2", u"value3")
+        assert row["col_2"] == row.col_2 == u"value2"
+        assert row.items() == {"col1": 2, "col_2": u"value2", "col3": u"value3"}
+        assert json.loads(json.dumps(rows[0].items())) == {"col1": 1, "col_2": "value1", "col3": None}
+        assert rows[0].col3 is None
+        assert type(rows[0]) is type(row)
+        with pytest.raises(IndexError):
+            row[3]
+        with pytest.raises(AttributeError):
+            row["col4"]
+        with pytest.raises(AttributeError):
+            row.col4
+        assert encoder.serialize(row) == encoder.serialize((2, u"value2", u"value3"))
+
+    def test_lazy(self):
+        """
+        Ensure lazy rows decode the same values as tuple rows, only once,
+        and refuse to decode after the encoder columns have changed
+        """
+        for columns in [
+            Columns([
+                ("col1", INTEGER_NN, 4, 0, 0),
+                ("col2", VARCHAR_N, 20, 0, 0),
+                ("col3", DECIMAL_N, 8, 18, 2),
+                ("col4", DATE_N, 4, 0, 0),
+            ]),
+            Columns([
+                ("col1", INTEGER_NN, 4, 0, 0),
+                ("col2", CHAR_N, 6, 0, 0),
+                ("col3", DECIMAL_N, 8, 18, 2),
+                ("col4", DATE_N, 4, 0, 0),
+            ]),
+        ]:
+            encoder = giraffez.Encoder(columns)
+            expected = [(i, u"value{}".format(i), None if i % 3 else float(i) / 4, u"2015-01-01")
+                for i in range(10)]
+            data = b""
+            for values in expected:
+                row = encoder.serialize(values)
+                data += struct.pack("H", len(row)) + row
+            encoder |= ROW_ENCODING_LAZY
+            rows = encoder.readbuffer(data)
+            del data
+            assert [tuple(row) for row in rows] == expected
+            assert rows[4].col2 is rows[4][1]
+            assert rows[3]["col3"] == 0.75
+            assert rows[1].items() == {"col1": 1, "col2": u"value1", "col3": None, "col4": u"2015-01-01"}
+            assert encoder.serialize(rows[2]) == encoder.serialize(expected[2])
+            row = encoder.serialize(expected[5])
+            rows = encoder.readbuffer(struct.pack("H", len(row)) + row)
+            encoder |= ROW_ENCODING_LIST
+            with pytest.raises(EncoderError):
+                rows[0][0]
+
+    def test_pack_plan(self):
+        """
+        Ensure rows are packed the same whether items take the fast path
+        for exact builtin types or the generic conversion, for every row
+        type and null value
+        """
+        class Int(int): pass
+        class Float(float): pass
+        class Str(str): pass
+        columns = Columns([
+            ("col1", TD_BYTEINT, 1, 0, 0),
+            ("col2", TD_INTEGER, 4, 0, 0),
+            ("col3", TD_BIGINT, 8, 0, 0),
+            ("col4", TD_FLOAT, 8, 0, 0),
+            ("col5", TD_CHAR, 6, 0, 0),
+            ("col6", TD_VARCHAR, 20, 0, 0),
+        ])
+        encoder = giraffez.Encoder(columns)
+        values = (-3, 42, 2**40, 1.5, u"abc", u"caf\xe9")
+        expected = b"\x00" + struct.pack("<biqd", *values[:4]) + b"abc   " + \
+            struct.pack("<H", 5) + u"caf\xe9".encode("utf-8")
+        assert encoder.serialize(values) == expected
+        assert encoder.serialize(list(values)) == expected
+        assert encoder.serialize((Int(-3), Int(42), Int(2**40), Float(1.5), Str(u"abc"), Str(u"caf\xe9"))) == expected
+        assert encoder.serialize(("-3", "42", str(2**40), "1.5", b"abc", u"caf\xe9")) == expected
+        assert encoder.serialize(dict(zip(columns.names, values))) == expected
+        assert encoder.serialize(u"-3|42|{}|1.5|abc|caf\xe9".format(2**40)) == expected
+        encoder |= ROW_ENCODING_RECORD
+        record = encoder.read(expected)
+        assert encoder.serialize(record) == expected
+        encoder |= ROW_ENCODING_LIST
+        nulls = (None, 0, None, 0.0, u"NULL", None)
+        assert encoder.read(encoder.serialize(nulls)) == (None, 0, None, 0.0, u"NULL  ", None)
+        encoder.null = u"NULL"
+        nulls = (u"NULL", 0, u"NULL", 0.0, u"NULL", u"NULL")
+        assert encoder.read(encoder.serialize(nulls)) == nulls
+        assert encoder.read(encoder.serialize((Str(u"NULL"),) * 6)) == (u"NULL",) * 6
+        with pytest.raises(EncoderError):
+            encoder.serialize((1, 2, 3, 4.0, u"abcdefg", u""))
+        with pytest.raises(EncoderError):
+            encoder.serialize((1, 2, 3, 4.0, u"caf\xe9s!", u""))
+        with pytest.raises(EncoderError):
+            encoder.serialize((1, 2, 3, [], u"", u""))
+
+    def test_pack_buffer(self):
+        """
+        Ensure rows packed into a buffer match the rows packed one at a
+        time, that rows failing to pack are reported by index, and that
+        max_bytes splits the rows across buffers without losing any
+        """
+        columns = Columns([
+            ("col1", TD_INTEGER, 4, 0, 0),
+            ("col2", TD_VARCHAR, 20, 0, 0),
+            ("col3", TD_DATE, 4, 0, 0),
+        ])
+        encoder = giraffez.Encoder(columns)
+        rows = [(i, u"value {}".format(i) * (i % 3), "2015-01-{:02d}".format(i % 28 + 1)) for i in range(100)]
+        expected = b"".join(struct.pack("<H", len(r)) + r for r in map(encoder.serialize, rows))
+        data, errors = encoder.serializebuffer(rows)
+        assert data == expected and errors == []
+        assert encoder.count(data) == 100
+        assert encoder.readbuffer(data) == [encoder.read(encoder.serialize(r)) for r in rows]
+        assert encoder.serializebuffer(dict(zip(columns.names, r)) for r in rows)[0] == expected
+        assert encoder.serializebuffer([]) == (b"", [])
+        bad = [rows[0], (1, 2), rows[1], (u"abc", u"", None), (1, u"x", "2015-02-30"), rows[2]]
+        data, errors = encoder.serializebuffer(bad)
+        assert encoder.readbuffer(data) == [encoder.read(encoder.serialize(r)) for r in rows[:3]]
+        assert [i for i, _ in errors] == [1, 3, 4]
+        assert [type(error) for _, error in errors] == [EncoderError, ValueError, EncoderError]
+        with pytest.raises(ZeroDivisionError):
+            encoder.serializebuffer(1 // (3 - i) for i in range(5))
+        for max_bytes in [40, 64, 1000]:
+            buffers = []
+            for data, errors in encoder.serializebuffers(rows, max_bytes):
+                assert errors == [] and 0 < len(data) <= max_bytes
+                buffers.append(data)
+            assert b"".join(buffers) == expected
+            assert len(buffers) > len(expected) // max_bytes
+        bad = [(1, u"x" * 20, None), (2, u"a", None), (u"b", u"", None), (3, u"c", None), (4, u"d", None)]
+        errors = [e for _, errors in encoder.serializebuffers(bad, 16) for e in errors]
+        assert [i for i, _ in errors] == [0, 2]
+        data = b"".join(data for data, _ in encoder.serializebuffers(bad, 16))
+        assert encoder.readbuffer(data) == [(2, u"a", None), (3, u"c", None), (4, u"d", None)]
+
+    def test_pack_buffer_state(self):
+        """
+        Ensure the row that did not fit in max_bytes is only written when
+        its state is passed back, survives a failing call, and is checked
+        against the max_bytes of the call writing it
+        """
+        columns = Columns([("col1", TD_INTEGER, 4, 0, 0), ("col2", TD_VARCHAR, 20, 0, 0)])
+        encoder = giraffez.Encoder(columns)
+        rows = [(0, u"v0"), (1, u"v1"), (2, u"v2")]
+        it = iter(rows)
+        data, errors, state = encoder.encoder.pack_rows(it, 20)
+        assert encoder.readbuffer(data) == rows[:1] and state[0] == 1
+        data, errors, _ = encoder.encoder.pack_rows([(100, u"other")])
+        assert encoder.readbuffer(data) == [(100, u"other")]
+        with pytest.raises(ZeroDivisionError):
+            encoder.encoder.pack_rows((1 // 0 for i in range(1)), 20, state)
+        data, errors, next_state = encoder.encoder.pack_rows(it, 20, state)
+        assert encoder.readbuffer(data) == rows[1:2] and next_state[0] == 2
+        data, errors, next_state = encoder.encoder.pack_rows(it, 10, next_state)
+        assert data == b"" and [i for i, _ in errors] == [2] and next_state is None
+        with pytest.raises(TypeError):
+            encoder.encoder.pack_rows(rows, 20, (0, u"row"))
+
     def test_wrong_number_input(self, encoder):
         encoder.columns = [
             ('col1', TD_INTEGER, 4, 0, 0),
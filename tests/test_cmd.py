@@ -68,12 +68,43 @@ class TestCmd(object):
         result = list(cmd.execute(query))
 
         assert [x.items() for x in result] == expected_rows
+        assert all(isinstance(x, giraffez.types.Row) for x in result)
 
         cmd._close()
         
         # This ensures that the config was proper mocked
         connect_mock.assert_called_with('db1', 'user123', 'pass456', None, None)
 
+    def test_results_record(self, mocker):
+        connect_mock = mocker.patch('giraffez.cmd.TeradataCmd._connect')
+        mock_columns = mocker.patch("giraffez.cmd.Cursor._columns")
+
+        cmd = giraffez.Cmd()
+        query = "select * from db1.info"
+        columns = Columns([
+            ("col1", VARCHAR_NN, 50, 0, 0),
+            ("items", VARCHAR_N, 50, 0, 0),
+        ])
+
+        mock_columns.return_value = columns
+
+        # Records are created by the encoder of the connection
+        encoder = giraffez.Encoder(columns)
+        data = encoder.serialize(["value1", "value2"])
+        encoder |= ROW_ENCODING_RECORD
+        rows = [encoder.read(data) for i in range(2)]
+
+        cmd.cmd = mocker.MagicMock()
+        cmd.cmd.fetchone.side_effect = ResultsHelper(rows)
+        result = list(cmd.execute(query).to_record())
+
+        assert cmd.cmd.set_encoding.call_args[0][0] == ROW_ENCODING_RECORD
+        assert [x.items() for x in result] == [{"col1": "value1", "items": "value2"}] * 2
+        assert [x["items"] for x in result] == ["value2"] * 2
+        assert repr(result[0]).startswith("Record(")
+
+        cmd._close()
+
     def test_invalid_credentials(self, mocker):
         connect_mock = mocker.patch('giraffez.cmd.TeradataCmd._connect')
         connect_mock.side_effect = InvalidCredentialsError("test")
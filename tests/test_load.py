@@ -48,3 +48,28 @@ class TestMLoad(object):
         assert load.mload.end_acquisition.called == True
         assert load.mload.apply_rows.called == True
         assert load.mload.close.called == True
+
+    def test_bulkload_from_file_parse_dates(self, mocker, tmpfiles):
+        mocker.patch('giraffez.load.TeradataBulkLoad._connect')
+        with open(tmpfiles.load_file, 'w') as f:
+            f.write("col1|col2\n")
+            f.write("value1|2015-01-09T12:00:00\n")
+        load = giraffez.BulkLoad("db1.info")
+        load.mload = mocker.MagicMock()
+        load.mload.status.return_value = 0
+        load.mload.put_row.return_value = 0
+        load.mload.exists.return_value = False
+        load.mload.checkpoint.return_value = 0
+        load.mload.get_event.side_effect = [
+            b'\x00\x00',
+            b'\x00\x00',
+            b'\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x80',
+            b'\x00\x00\x00\x00',
+            b'\x00\x00',
+        ]
+        with pytest.warns(DeprecationWarning):
+            load.from_file(tmpfiles.load_file, parse_dates=True)
+        load._close()
+
+        # TIMESTAMP text is passed to the encoder as it was read
+        load.mload.put_row.assert_called_once_with(["value1", "2015-01-09T12:00:00"])